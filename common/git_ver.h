@@ -0,0 +1,4 @@
+#define GIT_COMMIT "ccb59a0367f95a366f421ca751d919bf60f486d3"
+#define GIT_VER "master"
+#define GIT_NUM 35
+#define BUILD_DATE "Oct 17 2026 @ 22:11:36"
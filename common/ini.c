@@ -0,0 +1,428 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "plugin_common.h"
+#define _atoi atoi
+
+/// https://github.com/Teklad/tconfig > https://github.com/gimli2/tconfig
+#include "ini.h"
+
+#define INI_ARENA_BLOCK 4096
+
+static ini_block_s *_ini_arena_push(ini_table_s *table, size_t size) {
+    size_t block_size = size > INI_ARENA_BLOCK ? size : INI_ARENA_BLOCK;
+    ini_block_s *block = (ini_block_s *)malloc(sizeof(ini_block_s) + block_size);
+    block->next = table->arena;
+    block->size = block_size;
+    block->used = 0;
+    table->arena = block;
+    return block;
+}
+
+static void *_ini_arena_alloc(ini_table_s *table, size_t size, size_t align) {
+    ini_block_s *block = table->arena;
+    size_t offset = block == NULL ? 0 : (block->used + align - 1) & ~(align - 1);
+    if (block == NULL || offset + size > block->size) {
+        block = _ini_arena_push(table, size);
+        offset = 0;
+    }
+    block->used = offset + size;
+    return (char *)(block + 1) + offset;
+}
+
+// Makes sure the next `size' bytes come from one block.
+static void _ini_arena_reserve(ini_table_s *table, size_t size) {
+    ini_block_s *block = table->arena;
+    if (block == NULL || block->size - block->used < size) {
+        _ini_arena_push(table, size);
+    }
+}
+
+static char *_ini_arena_strdup(ini_table_s *table, const char *str) {
+    size_t size = strlen(str) + 1;
+    char *copy = (char *)_ini_arena_alloc(table, size, 1);
+    memcpy(copy, str, size);
+    return copy;
+}
+
+// Arrays grow by doubling into a new arena allocation, the old copy stays
+// unused until the table is destroyed.
+static void *_ini_arena_grow(ini_table_s *table, void *array, int size, int *capacity, size_t item_size) {
+    int new_capacity = *capacity ? *capacity * 2 : 8;
+    void *new_array = _ini_arena_alloc(table, new_capacity * item_size, sizeof(void *));
+    if (size) {
+        memcpy(new_array, array, size * item_size);
+    }
+    *capacity = new_capacity;
+    return new_array;
+}
+
+// Sections with fewer keys are faster to scan than to hash.
+#define INI_INDEX_MIN 8
+
+static unsigned int _ini_hash(const char *str) {
+    unsigned int hash = 2166136261u;
+    while (*str) {
+        hash = (hash ^ (unsigned char)*str++) * 16777619u;
+    }
+    return hash;
+}
+
+// Sections and entries both start with their name, so the index works on
+// either: item `i' is named by the pointer at base + i * stride.
+static const char *_ini_item_name(const void *base, size_t stride, int i) {
+    return *(char *const *)((const char *)base + i * stride);
+}
+
+static int _ini_index_find(const ini_index_s *index, const void *base, size_t stride, const char *name) {
+    unsigned int hash = _ini_hash(name);
+    for (unsigned int i = hash & index->mask;; i = (i + 1) & index->mask) {
+        const ini_slot_s *slot = &index->slot[i];
+        if (slot->index < 0) {
+            return -1;
+        }
+        if (slot->hash == hash && strcmp(_ini_item_name(base, stride, slot->index), name) == 0) {
+            return slot->index;
+        }
+    }
+}
+
+static void _ini_index_put(ini_index_s *index, const void *base, size_t stride, int item) {
+    const char *name = _ini_item_name(base, stride, item);
+    unsigned int hash = _ini_hash(name);
+    unsigned int i = hash & index->mask;
+    for (; index->slot[i].index >= 0; i = (i + 1) & index->mask) {
+        // the first of duplicate names wins, as with a linear search
+        if (index->slot[i].hash == hash && strcmp(_ini_item_name(base, stride, index->slot[i].index), name) == 0) {
+            return;
+        }
+    }
+    index->slot[i].hash = hash;
+    index->slot[i].index = item;
+}
+
+static void _ini_index_build(ini_table_s *table, ini_index_s *index, const void *base, size_t stride, int count) {
+    unsigned int slots = 16;
+    while (slots < (unsigned int)count * 2) {
+        slots *= 2;
+    }
+    index->slot = (ini_slot_s *)_ini_arena_alloc(table, slots * sizeof(ini_slot_s), sizeof(ini_slot_s));
+    index->mask = slots - 1;
+    memset(index->slot, 0xff, slots * sizeof(ini_slot_s));
+    for (int i = 0; i < count; i++) {
+        _ini_index_put(index, base, stride, i);
+    }
+}
+
+// Adds the newest of `count' items, rebuilt larger once half full.
+static void _ini_index_add(ini_table_s *table, ini_index_s *index, const void *base, size_t stride, int count) {
+    if ((unsigned int)count * 2 > index->mask + 1) {
+        _ini_index_build(table, index, base, stride, count);
+    } else {
+        _ini_index_put(index, base, stride, count - 1);
+    }
+}
+
+// Adds an entry that points at `key' and `value' without copying them.
+static ini_entry_s *_ini_entry_add(ini_table_s *table, ini_section_s *section, char *key, char *value) {
+    if (section->size == section->capacity) {
+        section->entry = (ini_entry_s *)_ini_arena_grow(table, section->entry, section->size, &section->capacity, sizeof(ini_entry_s));
+    }
+    ini_entry_s *entry = &section->entry[section->size++];
+    debug_printf("key: %s = value: %s\n", key, value);
+    entry->key = key;
+    entry->value = value;
+    if (section->index.slot != NULL) {
+        _ini_index_add(table, &section->index, section->entry, sizeof(ini_entry_s), section->size);
+    }
+    return entry;
+}
+
+static ini_entry_s *_ini_entry_create(ini_table_s *table, ini_section_s *section, const char *key, const char *value) {
+    return _ini_entry_add(table, section, _ini_arena_strdup(table, key), _ini_arena_strdup(table, value));
+}
+
+// Adds a section named by `name' without copying it.
+static ini_section_s *_ini_section_add(ini_table_s *table, char *name) {
+    if (table->size == table->capacity) {
+        table->section = (ini_section_s *)_ini_arena_grow(table, table->section, table->size, &table->capacity, sizeof(ini_section_s));
+    }
+    ini_section_s *section = &table->section[table->size++];
+    section->size = 0;
+    section->capacity = 0;
+    section->name = name;
+    section->entry = NULL;
+    section->index.slot = NULL;
+    section->index.mask = 0;
+    if (table->index.slot != NULL) {
+        _ini_index_add(table, &table->index, table->section, sizeof(ini_section_s), table->size);
+    }
+    return section;
+}
+
+static ini_section_s *_ini_section_create(ini_table_s *table, const char *section_name) {
+    return _ini_section_add(table, _ini_arena_strdup(table, section_name));
+}
+
+// Ctn: make this non-static
+ini_section_s *_ini_section_find(ini_table_s *table, const char *name) {
+    if (table->index.slot != NULL) {
+        int i = _ini_index_find(&table->index, table->section, sizeof(ini_section_s), name);
+        return i < 0 ? NULL : &table->section[i];
+    }
+    for (int i = 0; i < table->size; i++) {
+        if (strcmp(table->section[i].name, name) == 0) {
+            return &table->section[i];
+        }
+    }
+    return NULL;
+}
+
+static ini_entry_s *_ini_entry_find(ini_table_s *table, ini_section_s *section, const char *key) {
+    // keys are indexed on the first lookup, only a few sections are ever read
+    if (section->index.slot == NULL && table->index.slot != NULL && section->size >= INI_INDEX_MIN) {
+        _ini_index_build(table, &section->index, section->entry, sizeof(ini_entry_s), section->size);
+    }
+    if (section->index.slot != NULL) {
+        int i = _ini_index_find(&section->index, section->entry, sizeof(ini_entry_s), key);
+        return i < 0 ? NULL : &section->entry[i];
+    }
+    for (int i = 0; i < section->size; i++) {
+        if (strcmp(section->entry[i].key, key) == 0) {
+            return &section->entry[i];
+        }
+    }
+    return NULL;
+}
+
+static ini_entry_s *_ini_entry_get(ini_table_s *table, const char *section_name, const char *key) {
+    ini_section_s *section = _ini_section_find(table, section_name);
+    if (section == NULL) {
+        return NULL;
+    }
+
+    ini_entry_s *entry = _ini_entry_find(table, section, key);
+    if (entry == NULL) {
+        return NULL;
+    }
+    return entry;
+}
+
+ini_table_s *ini_table_create() {
+    ini_table_s *table = (ini_table_s *)malloc(sizeof(ini_table_s));
+    table->section = NULL;
+    table->size = 0;
+    table->capacity = 0;
+    table->arena = NULL;
+    table->index.slot = NULL;
+    table->index.mask = 0;
+    return table;
+}
+
+void ini_table_destroy(ini_table_s *table) {
+    ini_block_s *block = table->arena;
+    while (block != NULL) {
+        ini_block_s *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(table);
+}
+
+void ini_table_build_index(ini_table_s *table) {
+    _ini_index_build(table, &table->index, table->section, sizeof(ini_section_s), table->size);
+}
+
+void ini_table_parse(ini_table_s* table, char* text, size_t size)
+{
+    ini_section_s* current_section = NULL;
+    char* end = text + size;
+    char* line = text;
+    // The first line is expected to open a section, text on it before a `]' is not a key.
+    bool first_line = true;
+
+    // Every character writes at most one output byte, so each line is
+    // tokenized in place over the text it has already consumed. A `]' moves
+    // the output past itself, the section name before it is kept.
+    while (1) {
+        char* eol = (char*)memchr(line, '\n', end - line);
+        char* stop = eol != NULL ? eol : end;
+        char* comment = (char*)memchr(line, ';', stop - line);
+        if (comment != NULL)
+            stop = comment;
+
+        enum {Section, Key, Value} state = first_line ? Section : Key;
+        int position = 0;
+        int spaces   = 0;
+        int value    = 0;
+        for (char* p = line; p < stop; p++) {
+            char c = *p;
+            switch(c) {
+                case '\r':
+                    break;
+                case ' ':
+                    // leading spaces are dropped, inner ones are kept once text follows
+                    switch(state) {
+                        case Value: if (position > value && line[value] != '\0') spaces++; break;
+                        default: if (position > 0 && line[0] != '\0') spaces++; break;
+                    }
+                    break;
+                case '[':
+                    state = Section;
+                    break;
+                case ']':
+                    line[position] = '\0';
+                    current_section = _ini_section_add(table, line);
+                    line = p + 1;
+                    position = 0;
+                    spaces = 0;
+                    state = Key;
+                    break;
+                case '=':
+                    if (state == Key) {
+                        state = Value;
+                        line[position++] = '\0';
+                        value = position;
+                        spaces = 0;
+                        break;
+                    }
+                    // fallthrough
+                default:
+                    for(;spaces > 0; spaces--) line[position++] = ' ';
+                    line[position++] = c;
+                    break;
+            }
+        }
+
+        line[position] = '\0';
+        if (state == Value) {
+            if (current_section == NULL) {
+                current_section = _ini_section_create(table, "");
+            }
+            _ini_entry_add(table, current_section, line, line + value);
+        } else if (strlen(line) > 1 && position && state == Key) {
+            if (current_section == NULL) {
+                current_section = _ini_section_create(table, "");
+            }
+            _ini_entry_add(table, current_section, line, line + position);
+        } else if (state == Section) {
+            debug_printf("Section `%s' missing `]' operator.\n", line);
+        } else if (state == Key && position) {
+            debug_printf("Key `%s' missing `=' operator.\n", line);
+        }
+
+        if (eol == NULL)
+            break;
+        line = eol + 1;
+        first_line = false;
+    }
+}
+
+bool ini_table_read_from_file(ini_table_s *table, const char *file) {
+    FILE *f = fopen(file, "rb");
+    if (f == NULL) {
+        return false;
+    }
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        size = ftell(f);
+    }
+    bool ok = size >= 0 && fseek(f, 0, SEEK_SET) == 0;
+    if (ok) {
+        // the text is kept as the table's strings, the arrays rarely need more than twice its size again
+        _ini_arena_reserve(table, size * 3 + INI_ARENA_BLOCK);
+        char *text = (char *)_ini_arena_alloc(table, size + 1, 1);
+        ok = fread(text, 1, size, f) == (size_t)size;
+        if (ok) {
+            ini_table_parse(table, text, size);
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+bool ini_table_write_to_file(ini_table_s *table, const char *file) {
+    FILE *f = fopen(file, "w+");
+    if (f == NULL)
+        return false;
+    for (int i = 0; i < table->size; i++) {
+        ini_section_s *section = &table->section[i];
+        fprintf(f, i > 0 ? "\n[%s]\n" : "[%s]\n", section->name);
+        for (int q = 0; q < section->size; q++) {
+            ini_entry_s *entry = &section->entry[q];
+            if (entry->key[0] == ';') {
+                fprintf(f, "%s\n", entry->key);
+            } else {
+                fprintf(f, "%s = %s\n", entry->key, entry->value);
+            }
+        }
+    }
+    if (fflush(f) == 0)
+        fsync(fileno(f));
+    fclose(f);
+    return true;
+}
+
+void ini_table_create_entry(ini_table_s *table, const char *section_name, const char *key, const char *value) {
+    ini_section_s *section = _ini_section_find(table, section_name);
+    if (section == NULL) {
+        section = _ini_section_create(table, section_name);
+    }
+    ini_entry_s *entry = _ini_entry_find(table, section, key);
+    if (entry == NULL) {
+        entry = _ini_entry_create(table, section, key, value);
+    } else {
+        // the old value stays in the arena until the table is destroyed
+        entry->value = _ini_arena_strdup(table, value);
+    }
+}
+
+bool ini_table_check_entry(ini_table_s *table, const char *section_name, const char *key) {
+    return (_ini_entry_get(table, section_name, key) != NULL);
+}
+
+const char *ini_table_get_entry(ini_table_s *table, const char *section_name, const char *key) {
+    ini_entry_s *entry = _ini_entry_get(table, section_name, key);
+    if (entry == NULL) {
+        return NULL;
+    }
+    return entry->value;
+}
+
+bool ini_table_get_entry_as_int(ini_table_s *table, const char *section_name, const char *key, int *value) {
+    const char *val = ini_table_get_entry(table, section_name, key);
+    if (val == NULL) {
+        return false;
+    }
+    *value = _atoi(val);
+    return true;
+}
+
+bool ini_table_get_entry_as_bool(ini_table_s *table, const char *section_name, const char *key, bool *value) {
+    const char *val = ini_table_get_entry(table, section_name, key);
+    if (val == NULL) {
+        return false;
+    }
+    if (strcasecmp(val, "on") == 0 || strcasecmp(val, "true") == 0 || strcasecmp(val, "1") == 0) {
+        *value = true;
+    } else {
+        *value = false;
+    }
+    return true;
+}
+
+bool ini_table_get_entry_as_enum(ini_table_s *table, const char *section_name, const char *key, const ini_enum_s *values, int *value) {
+    const char *val = ini_table_get_entry(table, section_name, key);
+    if (val == NULL) {
+        return false;
+    }
+    for (; values->name != NULL; values++) {
+        if (strcasecmp(val, values->name) == 0) {
+            *value = values->value;
+            return true;
+        }
+    }
+    return false;
+}
@@ -2,6 +2,7 @@
 
 #ifndef GH_LIB
 #include <stdbool.h>
+#include <stddef.h>
 #endif
 
 typedef struct ini_entry_s {
@@ -9,17 +10,51 @@ typedef struct ini_entry_s {
     char *value;
 } ini_entry_s;
 
+// Open addressing slot, `index' is -1 while the slot is empty.
+typedef struct ini_slot_s {
+    unsigned int hash;
+    int index;
+} ini_slot_s;
+
+// Hash index over the names of sections or the keys of a section,
+// slot is NULL until ini_table_build_index() is called.
+typedef struct ini_index_s {
+    ini_slot_s *slot;
+    unsigned int mask;
+} ini_index_s;
+
 typedef struct ini_section_s {
     char *name;
     ini_entry_s *entry;
     int size;
+    int capacity;
+    ini_index_s index;
 } ini_section_s;
 
+// Block of table storage, the data follows the header.
+typedef struct ini_block_s {
+    struct ini_block_s *next;
+    size_t size;
+    size_t used;
+} ini_block_s;
+
+// The section and entry arrays, the text read from a file and any names
+// or values copied into the table live in the table's arena, they are
+// released together by ini_table_destroy().
 typedef struct ini_table_s {
     ini_section_s *section;
     int size;
+    int capacity;
+    ini_block_s *arena;
+    ini_index_s index;
 } ini_table_s;
 
+// Name of an enum value and the value it stands for, see ini_table_get_entry_as_enum().
+typedef struct ini_enum_s {
+    const char *name;
+    int value;
+} ini_enum_s;
+
 /**
  * @brief Creates an empty ini_table_s struct for writing new entries to.
  * @return ini_table_s*
@@ -41,6 +76,25 @@ void ini_table_destroy(ini_table_s *table);
  */
 bool ini_table_read_from_file(ini_table_s *table, const char *file);
 
+/**
+ * @brief Fills `table' from the `size' bytes of `text', tokenizing it in place
+ *        without copying.  Section names, keys and values point into `text',
+ *        which needs one writable byte past `size' and must outlive the table.
+ * @param table
+ * @param text
+ * @param size
+ */
+void ini_table_parse(ini_table_s *table, char *text, size_t size);
+
+/**
+ * @brief Builds a hash index over the section names of `table', so later
+ *        lookups do not scan every name.  The keys of a larger section are
+ *        indexed the first time one of them is looked up.  Sections and
+ *        entries created afterwards are added to the indexes.
+ * @param table
+ */
+void ini_table_build_index(ini_table_s *table);
+
 /**
  * @brief Writes the specified ini_table_s struct to the specified `file'.
  *        Returns false if the file could not be opened for writing, otherwise
@@ -105,5 +159,19 @@ bool ini_table_get_entry_as_int(ini_table_s *table, const char *section_name, co
  */
 bool ini_table_get_entry_as_bool(ini_table_s *table, const char *section_name, const char *key, bool *value);
 
+/**
+ * @brief Retrieves the value of the specified `key' in `section_name', converted
+ *        through `values', a list of names ending with a NULL name.  Names are
+ *        matched ignoring case.  Returns false if the entry does not exist or
+ *        is not in the list, true otherwise.
+ * @param table
+ * @param section_name
+ * @param key
+ * @param values
+ * @param [out]value
+ * @return bool
+ */
+bool ini_table_get_entry_as_enum(ini_table_s *table, const char *section_name, const char *key, const ini_enum_s *values, int *value);
+
 // Ctn: make this non-static
 ini_section_s *_ini_section_find(ini_table_s *table, const char *name);
@@ -0,0 +1,18 @@
+#include <Common.h>
+#include "plugin_common.h"
+
+#pragma once
+
+// Growable byte buffer, used as an append-only arena.
+// Offsets stay valid when the buffer grows, pointers don't.
+struct byte_buffer_t
+{
+    u8 *data;
+    u32 size;
+    u32 capacity;
+};
+
+u8 *buffer_reserve(byte_buffer_t *buffer, u32 size);
+u32 buffer_append(byte_buffer_t *buffer, const void *data, u32 size);
+u32 buffer_append_string(byte_buffer_t *buffer, const char *str);
+void buffer_free(byte_buffer_t *buffer);
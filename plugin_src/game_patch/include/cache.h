@@ -0,0 +1,41 @@
+#include <Common.h>
+#include "plugin_common.h"
+#include "scan.h"
+
+#pragma once
+
+#define SIG_CACHE_MAGIC 0x43535047 // 'GPSC'
+#define SIG_CACHE_VERSION 2
+#define SIG_CACHE_NOT_FOUND ~0ul
+
+struct sig_cache_header_t
+{
+    u32 magic;
+    u32 version;
+    u64 fingerprint;
+    u32 count;
+    u32 reserved;
+};
+
+struct sig_cache_entry_t
+{
+    u64 sig_hash;
+    u64 offset; // relative to module base, SIG_CACHE_NOT_FOUND if the signature has no match
+};
+
+struct sig_cache_t
+{
+    u64 fingerprint;
+    sig_cache_entry_t *entry;
+    u32 size;
+    bool dirty;
+};
+
+u64 module_fingerprint(u32 crc, const char *name, const char *version);
+void sig_cache_load(sig_cache_t *cache, const char *path, u64 fingerprint);
+bool sig_cache_lookup(const sig_cache_t *cache, u64 sig_hash, u64 *offset);
+void sig_cache_store(sig_cache_t *cache, u64 sig_hash, u64 offset);
+void sig_cache_save(const sig_cache_t *cache, const char *path);
+void sig_cache_free(sig_cache_t *cache);
+u32 sig_cache_apply(const sig_cache_t *cache, sig_table_t *table, u64 base);
+void sig_cache_update(sig_cache_t *cache, const sig_table_t *table, u64 base);
@@ -0,0 +1,33 @@
+#include <Common.h>
+#include "plugin_common.h"
+
+#pragma once
+
+// Code caves for mask_jump32 detours.
+// Free space is taken from runs of padding (0xCC, 0x90 or 0x00) in executable segments.
+
+#define CAVE_MIN_RUN 32 // shorter runs are not used
+#define CAVE_GUARD 8    // bytes left at each end of a run, they may belong to an instruction
+#define CAVE_ALIGN 16
+
+struct cave_range_t
+{
+    u64 addr;
+    u64 size;
+};
+
+struct cave_pool_t
+{
+    cave_range_t *run; // free space
+    u32 run_count;
+    cave_range_t *claim; // caves handed out or named by a Target
+    u32 claim_count;
+    bool scanned;
+};
+
+void cave_pool_scan(cave_pool_t *pool, u64 base, u64 size);
+u64 cave_alloc(cave_pool_t *pool, u64 site, u32 size);
+bool cave_claim(cave_pool_t *pool, u64 addr, u32 size);
+void cave_reserve(cave_pool_t *pool, u64 addr, u32 size);
+void cave_release(cave_pool_t *pool, u64 addr);
+void cave_pool_free(cave_pool_t *pool);
@@ -0,0 +1,19 @@
+#include <Common.h>
+#include "plugin_common.h"
+
+#pragma once
+
+// Control file, a text file of commands that is polled while the game runs.
+// It is read again whenever its size or modification time changes.
+
+struct control_file_t
+{
+    char path[MAX_PATH_];
+    u64 size;
+    u64 mtime_sec;
+    u64 mtime_nsec;
+};
+
+void control_init(control_file_t *control, const char *path);
+char *control_poll(control_file_t *control);
+char *control_next_line(char **cursor);
@@ -0,0 +1,9 @@
+#include <Common.h>
+#include "plugin_common.h"
+
+#pragma once
+
+// CRC32C (Castagnoli). Uses the SSE4.2 crc32 instruction, which every console CPU has.
+// Linux hosts without SSE4.2 fall back to a table.
+
+u32 crc32c(u32 crc, const void *data, u64 size);
@@ -0,0 +1,44 @@
+#include <Common.h>
+#include "plugin_common.h"
+
+#pragma once
+
+// Patch database (.ghdb), the compiled patch files of a whole repository in one file.
+// Layout: header, title index sorted by title id, then one .ghp file per title.
+// Built on a PC by tools/patch_db, entries are compiled unfiltered with the
+// settings hashes of the xml path on the console. An entry that matches the
+// local xml is saved as the title's .ghp file.
+
+#define GHDB_MAGIC 0x42444847 // 'GHDB'
+#define GHDB_VERSION 2
+#define GHDB_ALIGN 16 // .ghp files start on this alignment
+
+// xml path of a title on the console, part of every settings hash
+#define GHDB_XML_PATH GOLDHEN_PATH "/patches/xml/%s.xml"
+
+struct ghdb_header_t
+{
+    u32 magic;
+    u32 version;
+    u32 ghp_version; // GHP_VERSION the titles were compiled with
+    u32 title_count;
+    u64 index_offset;
+    u64 data_offset;
+};
+
+struct ghdb_title_t
+{
+    char titleid[16];
+    u64 offset; // from the start of the file
+    u64 size;
+    u64 xml_size; // size of the source xml
+    u32 xml_crc;  // crc32c() of the source xml
+    u32 reserved;
+};
+
+inline s32 ghdb_title_cmp(const char *a, const char *b)
+{
+    return strncmp(a, b, sizeof(((ghdb_title_t *)0)->titleid));
+}
+
+bool ghdb_load(const char *path, const char *titleid, u64 xml_size, u32 xml_crc, u8 **out, u64 *out_size);
@@ -0,0 +1,83 @@
+#include <Common.h>
+#include "plugin_common.h"
+
+#pragma once
+
+// Compiled patch file (.ghp)
+// Layout: header, entries, lines, string pool, payload pool.
+// All references are offsets from the start of the file so it can be used in place.
+
+#define GHP_MAGIC 0x31504847 // 'GHP1'
+#define GHP_VERSION 6
+
+#define GHP_ENTRY_EARLY (1 << 0)       // Metadata Early="1", applied before boot continues
+#define GHP_ENTRY_FINGERPRINT (1 << 1) // app_fingerprint is set
+
+#define GHP_LINE_MASK (1 << 0) // Address is a signature
+
+struct ghp_header_t
+{
+    u32 magic;
+    u32 version;
+    u64 xml_size;  // source xml size and mtime, the file is rebuilt when either changes
+    u64 xml_mtime;
+    u64 filter_hash; // ghp_filter_hash() of the executable the file was compiled for, 0 if unfiltered
+    u32 entry_count;
+    u32 line_count;
+    u32 entries_offset;
+    u32 lines_offset;
+    u32 strings_offset;
+    u32 strings_size;
+    u32 payload_offset;
+    u32 payload_size;
+};
+
+struct ghp_entry_t
+{
+    u64 settings_hash; // patch_hash_calc() of the entry
+    u32 title;         // string offsets
+    u32 name;
+    u32 app_ver;
+    u32 app_elf;
+    u32 first_line;
+    u32 line_count;
+    u32 flags;
+    u32 module; // string offset of the target module, empty for the main executable
+    u32 app_fingerprint; // AppFingerprint, module_crc32c() of the executable
+    u32 reserved;
+};
+
+struct ghp_line_t
+{
+    u64 type_hash;  // djb2_hash() of Type
+    u64 addr;       // parsed Address, unused for masks
+    s64 offset;     // mask Offset
+    u32 addr_str;   // string offset of Address
+    u32 target_str; // string offset of mask_jump32 Target
+    u32 payload;    // offset of the decoded Value
+    u32 payload_size;
+    u32 jump_size;
+    u32 flags;
+};
+
+struct ghp_t
+{
+    u8 *data;
+    u64 size;
+    const ghp_header_t *header;
+    const ghp_entry_t *entry;
+    const ghp_line_t *line;
+    const char *strings;
+    const u8 *payload;
+};
+
+u64 ghp_filter_hash(const char *app_elf, const char *app_ver);
+bool ghp_compile(const char *xml, const char *xml_path, const char *app_elf, const char *app_ver,
+                 u64 xml_size, u64 xml_mtime, u8 **out, u64 *out_size);
+bool ghp_open(ghp_t *ghp, u8 *data, u64 size);
+void ghp_free(ghp_t *ghp);
+
+inline const char *ghp_string(const ghp_t *ghp, u32 offset)
+{
+    return ghp->strings + offset;
+}
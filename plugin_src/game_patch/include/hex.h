@@ -0,0 +1,12 @@
+#include <Common.h>
+#include "plugin_common.h"
+
+#pragma once
+
+// Most bytes hex_decode() can write for `len` characters
+inline u64 hex_decoded_max(u64 len)
+{
+    return len / 2 + 1;
+}
+
+bool hex_decode(const char *str, u64 len, u8 *out, u64 *out_size, u64 *error_pos);
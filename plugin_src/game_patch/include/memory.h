@@ -0,0 +1,29 @@
+#include <Common.h>
+#include "plugin_common.h"
+
+#pragma once
+
+// Page protection, fault-free reads and direct memory writes.
+// Implemented with sceKernel* on the console and their POSIX counterparts on Linux hosts.
+
+#define MEM_PROT_READ  0x1
+#define MEM_PROT_WRITE 0x2
+#define MEM_PROT_EXEC  0x4
+
+#define MEM_PAGE_SIZE 0x4000
+
+enum write_mode_t
+{
+    WRITE_MODE_PROC_RW, // sys_sdk_proc_rw() kernel round trip for every write
+    WRITE_MODE_DIRECT,  // unprotect, memcpy, restore; proc_rw for pages that can't be remapped
+};
+
+bool mem_query_protection(u64 addr, u64 *start, u64 *end, s32 *prot);
+bool mem_next_region(u64 addr, u64 *start, u64 *end, s32 *prot);
+bool mem_protect(u64 addr, u64 size, s32 prot);
+bool mem_read(u64 addr, void *data, u64 size);
+void *mem_map(u64 size);
+void mem_unmap(void *data, u64 size);
+bool mem_write_direct(u64 addr, const void *data, u64 size);
+u32 mem_write_direct_spans(const u64 *addr, const u64 *size, const u8 *data, const u64 *offset,
+                           const u8 *skip, u32 count, u8 *done);
@@ -0,0 +1,45 @@
+#include <Common.h>
+#include "plugin_common.h"
+#include "cave.h"
+#include "scan.h"
+
+#pragma once
+
+// Loaded modules of the process and their segments, listed once at start.
+
+#define MODULE_MAX_SEGMENTS 4
+
+struct module_segment_t
+{
+    u64 addr;
+    u32 size;
+    s32 prot; // ORBIS_KERNEL_PROT_CPU_*
+};
+
+struct module_entry_t
+{
+    char name[256];
+    u64 name_hash; // djb2_hash() of name
+    u64 base;      // segment 0
+    u32 size;
+    u64 fingerprint; // module_fingerprint(), 0 until first use
+    u32 crc;         // module_crc32c()
+    bool crc_valid;
+    module_segment_t segment[MODULE_MAX_SEGMENTS];
+    u32 segment_count;
+    cave_pool_t caves; // scanned before the first write to the module
+};
+
+struct module_map_t
+{
+    module_entry_t *module; // module[0] is the main executable
+    u32 size;
+};
+
+bool module_map_load(module_map_t *map);
+module_entry_t *module_map_add(module_map_t *map, OrbisKernelModule handle);
+module_entry_t *module_map_find(const module_map_t *map, const char *name);
+void module_map_free(module_map_t *map);
+cave_pool_t *module_cave_pool(module_entry_t *module);
+u32 module_crc32c(module_entry_t *module);
+u64 module_resolve_signatures(const module_entry_t *module, sig_table_t *table, u32 threads);
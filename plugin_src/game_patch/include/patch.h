@@ -1,16 +1,74 @@
 #include <Common.h>
 #include "plugin_common.h"
+#include "buffer.h"
+#include "hex.h"
+#include "memory.h"
 #include <stdbool.h>
 
 #pragma once
 
-unsigned char *hexstrtochar2(const char *hexstr, s64 *size);
 void sys_proc_rw(u64 address, void *data, u64 length);
+bool sys_proc_read(u64 address, void *data, u64 length);
 bool hex_prefix(const char *str);
 
 // http://www.cse.yorku.ca/~oz/hash.html
-constexpr inline u64 djb2_hash(const char *str);
+constexpr inline u64 djb2_hash(const char *str) {
+    u64 hash = 5381;
+    u32 c = 0;
+    while ((c = *str++))
+        hash = hash * 33 ^ c;
+    return hash;
+}
 
 u64 patch_hash_calc(const char *title, const char *name, const char *app_ver,
                     const char *title_id, const char *elf);
-void patch_data1(const char* patch_type_str, u64 addr, const char *value, uint32_t source_size, uint64_t jump_target);
+// Pending memory writes, applied with as few sys_proc_rw() calls as possible
+struct write_op_t
+{
+    u64 addr;
+    u32 data;  // offset into write_batch_t::data
+    u32 size;
+    u32 span;  // merged span index, set on flush
+    const char *owner; // patch name, for conflict reports
+    u32 tag;           // undo record tag, also tells patches apart in conflict reports
+};
+
+// Bytes replaced by flushed writes, so they can be restored later
+struct undo_record_t
+{
+    u64 addr;
+    u32 data; // offset into undo_log_t::data
+    u32 size;
+    u32 tag;  // write_batch_t::tag the write was queued with
+};
+
+struct undo_log_t
+{
+    undo_record_t *record;
+    u32 size;
+    byte_buffer_t data;
+};
+
+struct write_batch_t
+{
+    write_op_t *op;
+    u32 size;
+    u8 *data;
+    u32 data_size;
+    u32 data_capacity;
+    write_mode_t mode;
+    const char *owner; // owner of the writes queued next, must outlive the flush
+    u32 conflicts;     // overlapping writes of different tags, set on flush
+    undo_log_t *undo;  // receives the replaced bytes on flush, nullptr to not keep them
+    u32 tag;           // tag of the writes queued next
+};
+
+void write_batch_add(write_batch_t *batch, u64 addr, const void *data, u32 size);
+u32 write_batch_flush(write_batch_t *batch);
+u32 undo_log_restore(undo_log_t *log, write_batch_t *batch, u32 tag);
+bool undo_log_overlapped(const undo_log_t *log, u32 tag, u32 *newer_tag);
+void undo_log_free(undo_log_t *log);
+
+bool app_ver_matches(const char *game_ver, const char *AppVerData, bool has_fingerprint = false);
+bool patch_value_decode(u64 patch_type, const char *value, byte_buffer_t *out, u32 *size);
+void patch_data1(write_batch_t *batch, u64 patch_type, u64 addr, const u8 *data, s64 size, u32 source_size, u64 jump_target);
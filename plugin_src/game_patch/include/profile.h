@@ -0,0 +1,46 @@
+#include <Common.h>
+#include "plugin_common.h"
+
+#pragma once
+
+// Boot timing for game_patch.
+// The clock is sceKernelGetProcessTime() on the console and CLOCK_MONOTONIC on Linux hosts.
+
+#define PROFILE_LOG_PATH (const char*) GOLDHEN_PATH "/game_patch_profile.csv"
+
+enum profile_phase_t
+{
+    PROF_FILE_IO,  // Read_File()/Write_File() of xml and .ghp
+    PROF_PARSE,    // xml to .ghp compile
+    PROF_SETTINGS, // settings index and per patch settings files
+    PROF_SCAN,     // executable fingerprint, signature cache and pattern scanning
+    PROF_WRITE,    // write batch flush
+    PROF_PHASE_COUNT
+};
+
+struct profile_t
+{
+    u64 start;                        // profile_now() before the executable fingerprint in module_start()
+    u64 boot_us;                      // time module_start() was blocked
+    u64 total_us;                     // time until the last patch was written
+    u64 phase_us[PROF_PHASE_COUNT];
+    u64 bytes_scanned;
+    u32 patterns;                     // unique signatures
+    u32 patterns_cached;
+    u32 patterns_resolved;            // found, from cache or scan
+    u32 writes_queued;
+    u32 writes_issued;
+    u32 write_conflicts;              // overlapping writes of different patches
+};
+
+extern profile_t g_profile;
+
+u64 profile_now(void);
+
+static inline void profile_add(profile_phase_t phase, u64 start)
+{
+    g_profile.phase_us[phase] += profile_now() - start;
+}
+
+void profile_print(const profile_t *profile);
+void profile_write(const profile_t *profile, const char *path, const char *titleid, const char *elf, const char *ver);
@@ -0,0 +1,50 @@
+#include <Common.h>
+#include "plugin_common.h"
+
+#pragma once
+
+constexpr u32 MAX_PATTERN_LENGTH = 256;
+
+struct pattern_t
+{
+    u8 bytes[MAX_PATTERN_LENGTH];
+    u8 mask[MAX_PATTERN_LENGTH]; // 0xff: compare, 0x00: wildcard
+    s32 length;
+    s32 anchor[2];               // offsets of the two rarest fixed bytes
+};
+
+bool pattern_compile(const char* signature, pattern_t* pattern);
+u8* pattern_find(const pattern_t* pattern, u64 base, u64 size);
+u8* PatternScan(u64 module_base, u32 module_size, const char* signature);
+
+struct sig_entry_t
+{
+    pattern_t pattern;
+    u64 hash;   // djb2 of the signature string, entries are merged if it and the pattern match
+    u64 result; // resolved address, 0 if not found
+    s32 next;   // next entry in the same anchor bucket
+    bool valid;
+    bool resolved;
+    bool hash_shared; // another pattern has the same hash, kept out of the signature cache
+};
+
+// Workers used by sig_table_resolve_parallel() at most
+constexpr u32 SCAN_MAX_THREADS = 7;
+// Ranges are not split below this size per worker
+constexpr u64 SCAN_MIN_CHUNK = 0x40000;
+
+// Pending signatures needed before sig_table_resolve() builds a gram index of the range
+constexpr u32 SIG_INDEX_THRESHOLD = 8;
+// Gram occurrences kept per gram, grams seen more often are not used for lookups
+constexpr u32 SIG_GRAM_MAX_HITS = 4096;
+
+struct sig_table_t
+{
+    sig_entry_t *entry;
+    u32 size;
+};
+
+s32 sig_table_add(sig_table_t *table, const char *signature);
+u64 sig_table_resolve(sig_table_t *table, u64 base, u64 size);
+u64 sig_table_resolve_parallel(sig_table_t *table, u64 base, u64 size, u32 threads);
+void sig_table_free(sig_table_t *table);
@@ -0,0 +1,77 @@
+#include <Common.h>
+#include "plugin_common.h"
+
+#pragma once
+
+// Value search over process memory.
+// A first scan collects every aligned value that matches, later passes
+// narrow the candidates by comparing against the value each had before.
+// The core only reads the regions it is given, so it runs on buffers as well.
+// Memory is read with mem_read(), a region unmapped meanwhile is dropped
+// instead of faulting the game. Candidates are stored in mappings of their
+// own that the process scan leaves out.
+
+enum search_type_t
+{
+    SEARCH_U8,
+    SEARCH_U16,
+    SEARCH_U32,
+    SEARCH_U64,
+    SEARCH_F32,
+    SEARCH_F64,
+};
+
+enum search_cmp_t
+{
+    SEARCH_ANY,       // first scan only, every value is a candidate
+    SEARCH_EQ,        // == a
+    SEARCH_RANGE,     // a <= value <= b
+    SEARCH_CHANGED,   // later passes only, compared with the previous value
+    SEARCH_UNCHANGED,
+    SEARCH_INCREASED,
+    SEARCH_DECREASED,
+};
+
+struct search_filter_t
+{
+    search_cmp_t cmp;
+    u64 a; // raw bits of the value in the search type, f32 in the low 32 bits
+    u64 b;
+};
+
+// Candidates of one region, dense while many match, sparse once few do
+struct search_region_t
+{
+    u64 addr;
+    u64 size;      // multiple of the value size
+    u64 count;     // candidates left
+    u64 *bits;     // dense: bit n set if the value at addr + n * value size is a candidate
+    u8 *values;    // dense: copy of the region, sparse: previous value of each candidate
+    u8 *offsets;   // sparse: LEB128 deltas between candidate indices, nullptr while dense
+    u64 offsets_size;
+};
+
+struct search_t
+{
+    search_type_t type;
+    u32 value_size;
+    search_region_t *region;
+    u32 region_count;
+    u64 count;        // candidates of all regions
+    u32 passes;
+    u64 memory;       // bytes held by the candidate sets
+    u64 memory_limit; // regions that would go over are skipped on the first scan, 0 for no limit
+    bool revalidate;  // check regions are still mapped before reading them again
+};
+
+bool search_parse_type(const char *name, search_type_t *type);
+bool search_parse_value(search_type_t type, const char *str, u64 *value);
+void search_format_value(search_type_t type, u64 value, char *out, u32 out_size);
+u64 search_read_value(search_type_t type, u64 addr);
+
+void search_begin(search_t *search, search_type_t type);
+u64 search_first(search_t *search, u64 addr, u64 size, const search_filter_t *filter);
+u64 search_first_process(search_t *search, const search_filter_t *filter);
+u64 search_next(search_t *search, const search_filter_t *filter);
+u32 search_results(const search_t *search, u64 *addr, u32 max);
+void search_free(search_t *search);
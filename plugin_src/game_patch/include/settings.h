@@ -0,0 +1,48 @@
+#include <Common.h>
+#include "plugin_common.h"
+
+#pragma once
+
+// Index of patch settings, one sorted table instead of a file per patch hash.
+// The per hash files in the settings folder stay the interface for patch managers.
+// The index keeps the mtime of the settings folder, while it matches the
+// indexed flags are used without touching the files. Once it changes each
+// file is checked against the mtime its entry was read with, and only read
+// again when they differ. The index is imported from the files on first run.
+
+#define SETTINGS_INDEX_MAGIC 0x49535047 // 'GPSI'
+#define SETTINGS_INDEX_VERSION 3
+
+#define SETTINGS_FLAG_ENABLED (1 << 0)
+
+struct settings_header_t
+{
+    u32 magic;
+    u32 version;
+    u32 count;
+    u32 dir_mtime_nsec; // mtime of the settings folder when the index was saved
+    s64 dir_mtime_sec;
+};
+
+struct settings_entry_t
+{
+    u64 hash;
+    u32 flags;
+    u32 mtime_nsec; // mtime of the settings file when it was read, 0 if there was none
+    s64 mtime_sec;
+};
+
+struct settings_t
+{
+    settings_entry_t *entry;
+    u32 size;
+    u32 files_read; // settings files read because the index had no current entry
+    u32 files_checked; // sceKernelStat() calls of settings files
+    bool dir_current; // the folder is unchanged since the index was saved
+    bool dirty;
+};
+
+void settings_load(settings_t *settings, const char *index_path, const char *settings_dir);
+bool settings_enabled(settings_t *settings, u64 hash, const char *settings_dir);
+void settings_save(settings_t *settings, const char *index_path, const char *settings_dir);
+void settings_free(settings_t *settings);
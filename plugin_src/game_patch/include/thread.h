@@ -0,0 +1,16 @@
+#include <Common.h>
+#include "plugin_common.h"
+
+#pragma once
+
+// Minimal thread layer, scePthread on the console and pthreads on Linux hosts.
+
+#if defined(__linux__)
+#include <pthread.h>
+typedef pthread_t thread_t;
+#else
+typedef OrbisPthread thread_t;
+#endif
+
+bool thread_start(thread_t *thread, void *(*entry)(void *), void *arg, const char *name);
+void thread_join(thread_t thread);
@@ -0,0 +1,48 @@
+#include "buffer.h"
+
+/*
+ * @brief Make room for `size` more bytes
+ *
+ * @returns Start of the free space, bytes are added with `buffer->size += written`
+ */
+u8 *buffer_reserve(byte_buffer_t *buffer, u32 size)
+{
+    if (buffer->size + size > buffer->capacity)
+    {
+        while (buffer->size + size > buffer->capacity)
+        {
+            buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+        }
+        buffer->data = (u8 *)realloc(buffer->data, buffer->capacity);
+    }
+    return buffer->data + buffer->size;
+}
+
+u32 buffer_append(byte_buffer_t *buffer, const void *data, u32 size)
+{
+    u32 offset = buffer->size;
+    if (!size)
+    {
+        return offset;
+    }
+    memcpy(buffer_reserve(buffer, size), data, size);
+    buffer->size += size;
+    return offset;
+}
+
+u32 buffer_append_string(byte_buffer_t *buffer, const char *str)
+{
+    if (!str[0])
+    {
+        return 0; // pool starts with an empty string
+    }
+    return buffer_append(buffer, str, strlen(str) + 1);
+}
+
+void buffer_free(byte_buffer_t *buffer)
+{
+    free(buffer->data);
+    buffer->data = nullptr;
+    buffer->size = 0;
+    buffer->capacity = 0;
+}
@@ -0,0 +1,179 @@
+#include "cache.h"
+#include "crc32c.h"
+#include "utils.h"
+
+/*
+ * @brief Fingerprint a module so cached offsets are dropped when the game updates
+ *
+ * @param crc     module_crc32c() of the module
+ * @param name    Process or module name
+ * @param version Application version
+ * @returns       64 bit fingerprint, CRC32C of name and version in the high half
+ */
+u64 module_fingerprint(u32 crc, const char *name, const char *version)
+{
+    u32 id = crc32c(crc32c(0, name, strlen(name)), version, strlen(version));
+    u64 fingerprint = ((u64)id << 32) | crc;
+    debug_printf("fingerprint: 0x%016lx\n", fingerprint);
+    return fingerprint;
+}
+
+static s32 sig_cache_find(const sig_cache_t *cache, u64 sig_hash)
+{
+    s32 lo = 0;
+    s32 hi = (s32)cache->size - 1;
+    while (lo <= hi)
+    {
+        s32 mid = (lo + hi) / 2;
+        if (cache->entry[mid].sig_hash == sig_hash)
+        {
+            return mid;
+        }
+        if (cache->entry[mid].sig_hash < sig_hash)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    return -(lo + 1);
+}
+
+/*
+ * @brief Load the cache file, entries are kept only if `fingerprint` matches
+ */
+void sig_cache_load(sig_cache_t *cache, const char *path, u64 fingerprint)
+{
+    char *buffer = nullptr;
+    u64 size = 0;
+    cache->fingerprint = fingerprint;
+    cache->entry = nullptr;
+    cache->size = 0;
+    cache->dirty = false;
+    if (Read_File(path, &buffer, &size, 0))
+    {
+        debug_printf("No signature cache at %s\n", path);
+        return;
+    }
+    const sig_cache_header_t *header = (const sig_cache_header_t *)buffer;
+    if (size < sizeof(*header) ||
+        header->magic != SIG_CACHE_MAGIC ||
+        header->version != SIG_CACHE_VERSION ||
+        size < sizeof(*header) + header->count * sizeof(sig_cache_entry_t))
+    {
+        final_printf("Signature cache %s is invalid, discarding\n", path);
+    }
+    else if (header->fingerprint != fingerprint)
+    {
+        final_printf("Module fingerprint changed (0x%016lx != 0x%016lx), discarding signature cache\n",
+                     header->fingerprint, fingerprint);
+    }
+    else if (header->count)
+    {
+        cache->size = header->count;
+        cache->entry = (sig_cache_entry_t *)malloc(cache->size * sizeof(sig_cache_entry_t));
+        memcpy(cache->entry, buffer + sizeof(*header), cache->size * sizeof(sig_cache_entry_t));
+    }
+    free(buffer);
+}
+
+bool sig_cache_lookup(const sig_cache_t *cache, u64 sig_hash, u64 *offset)
+{
+    s32 index = sig_cache_find(cache, sig_hash);
+    if (index < 0)
+    {
+        return false;
+    }
+    *offset = cache->entry[index].offset;
+    return true;
+}
+
+void sig_cache_store(sig_cache_t *cache, u64 sig_hash, u64 offset)
+{
+    s32 index = sig_cache_find(cache, sig_hash);
+    if (index >= 0)
+    {
+        if (cache->entry[index].offset != offset)
+        {
+            cache->entry[index].offset = offset;
+            cache->dirty = true;
+        }
+        return;
+    }
+    index = -index - 1;
+    if ((cache->size % 16) == 0)
+    {
+        cache->entry = (sig_cache_entry_t *)realloc(cache->entry, (16 + cache->size) * sizeof(sig_cache_entry_t));
+    }
+    memmove(&cache->entry[index + 1], &cache->entry[index], (cache->size - index) * sizeof(sig_cache_entry_t));
+    cache->entry[index].sig_hash = sig_hash;
+    cache->entry[index].offset = offset;
+    cache->size++;
+    cache->dirty = true;
+}
+
+void sig_cache_save(const sig_cache_t *cache, const char *path)
+{
+    if (!cache->dirty)
+    {
+        return;
+    }
+    u64 size = sizeof(sig_cache_header_t) + cache->size * sizeof(sig_cache_entry_t);
+    u8 *buffer = (u8 *)malloc(size);
+    sig_cache_header_t *header = (sig_cache_header_t *)buffer;
+    header->magic = SIG_CACHE_MAGIC;
+    header->version = SIG_CACHE_VERSION;
+    header->fingerprint = cache->fingerprint;
+    header->count = cache->size;
+    header->reserved = 0;
+    memcpy(buffer + sizeof(*header), cache->entry, cache->size * sizeof(sig_cache_entry_t));
+    Write_File(path, buffer, size);
+    free(buffer);
+}
+
+void sig_cache_free(sig_cache_t *cache)
+{
+    free(cache->entry);
+    cache->entry = nullptr;
+    cache->size = 0;
+}
+
+/*
+ * @brief Mark every signature of `table` found in the cache as resolved
+ * @returns Number of signatures taken from the cache
+ */
+u32 sig_cache_apply(const sig_cache_t *cache, sig_table_t *table, u64 base)
+{
+    u32 hits = 0;
+    for (u32 i = 0; i < table->size; i++)
+    {
+        sig_entry_t *entry = &table->entry[i];
+        u64 offset = 0;
+        if (!entry->valid || entry->hash_shared || !sig_cache_lookup(cache, entry->hash, &offset))
+        {
+            continue;
+        }
+        entry->result = (offset == SIG_CACHE_NOT_FOUND) ? 0 : base + offset;
+        entry->resolved = true;
+        hits++;
+    }
+    return hits;
+}
+
+/*
+ * @brief Store the scan results of `table` in the cache
+ */
+void sig_cache_update(sig_cache_t *cache, const sig_table_t *table, u64 base)
+{
+    for (u32 i = 0; i < table->size; i++)
+    {
+        const sig_entry_t *entry = &table->entry[i];
+        if (!entry->valid || !entry->resolved || entry->hash_shared)
+        {
+            continue;
+        }
+        sig_cache_store(cache, entry->hash, entry->result ? entry->result - base : SIG_CACHE_NOT_FOUND);
+    }
+}
@@ -0,0 +1,185 @@
+#include "cave.h"
+
+static void range_add(cave_range_t **range, u32 *count, u64 addr, u64 size)
+{
+    if ((*count % 32) == 0)
+    {
+        *range = (cave_range_t *)realloc(*range, (32 + *count) * sizeof(cave_range_t));
+    }
+    (*range)[*count].addr = addr;
+    (*range)[*count].size = size;
+    (*count)++;
+}
+
+static void cave_take(cave_pool_t *pool, u64 addr, u64 size);
+
+/*
+ * @brief Add the padding runs of an executable segment to the pool
+ *
+ * Can be called once per segment. Caves claimed before the scan are left out.
+ */
+void cave_pool_scan(cave_pool_t *pool, u64 base, u64 size)
+{
+    const u8 *data = (const u8 *)base;
+    u64 i = 0;
+    u32 found = 0;
+    while (i < size)
+    {
+        u8 b = data[i];
+        if (b != 0xcc && b != 0x90 && b != 0x00)
+        {
+            i++;
+            continue;
+        }
+        u64 start = i;
+        while (i < size && data[i] == b)
+        {
+            i++;
+        }
+        // keep clear of the instructions around the run
+        u64 first = (base + start + CAVE_GUARD + CAVE_ALIGN - 1) & ~(u64)(CAVE_ALIGN - 1);
+        u64 last = base + i - CAVE_GUARD;
+        if (i - start >= CAVE_MIN_RUN && last > first)
+        {
+            range_add(&pool->run, &pool->run_count, first, last - first);
+            found++;
+        }
+    }
+    for (u32 i = 0; i < pool->claim_count; i++)
+    {
+        cave_take(pool, pool->claim[i].addr, pool->claim[i].size);
+    }
+    pool->scanned = true;
+    debug_printf("Code caves: %u runs in 0x%lx-0x%lx\n", found, base, base + size);
+}
+
+static bool rel32_reachable(u64 site, u64 cave, u32 size)
+{
+    // jmp at site to the cave, jmp at the cave end back after the site
+    s64 to_cave = (s64)(cave - (site + 5));
+    s64 back = (s64)(site - (cave + size));
+    return to_cave == (s32)to_cave && back == (s32)back;
+}
+
+static bool range_overlaps(const cave_range_t *range, u64 addr, u64 size)
+{
+    return addr < range->addr + range->size && range->addr < addr + size;
+}
+
+// take [addr, addr + size) out of the free runs
+static void cave_take(cave_pool_t *pool, u64 addr, u64 size)
+{
+    for (u32 i = 0; i < pool->run_count; i++)
+    {
+        cave_range_t *run = &pool->run[i];
+        if (!range_overlaps(run, addr, size))
+        {
+            continue;
+        }
+        u64 run_end = run->addr + run->size;
+        u64 end = addr + size;
+        if (addr > run->addr && end < run_end)
+        {
+            // split, the tail becomes a new run
+            run->size = addr - run->addr;
+            range_add(&pool->run, &pool->run_count, end, run_end - end);
+            continue;
+        }
+        if (addr <= run->addr)
+        {
+            run->size = end < run_end ? run_end - end : 0;
+            run->addr = end < run_end ? end : run_end;
+        }
+        else
+        {
+            run->size = addr - run->addr;
+        }
+    }
+}
+
+/*
+ * @brief Hand out a cave within rel32 range of a hook site
+ *
+ * @param pool Scanned pool
+ * @param site Address of the 5 byte jump into the cave
+ * @param size Cave size, payload and return jump
+ * @returns    Cave address, 0 if no free space is in range
+ */
+u64 cave_alloc(cave_pool_t *pool, u64 site, u32 size)
+{
+    for (u32 i = 0; i < pool->run_count; i++)
+    {
+        const cave_range_t *run = &pool->run[i];
+        u64 addr = (run->addr + CAVE_ALIGN - 1) & ~(u64)(CAVE_ALIGN - 1);
+        if (addr + size > run->addr + run->size || !rel32_reachable(site, addr, size))
+        {
+            continue;
+        }
+        cave_take(pool, run->addr, addr + size - run->addr);
+        range_add(&pool->claim, &pool->claim_count, addr, size);
+        debug_printf("Code cave 0x%lx size %u for 0x%lx\n", addr, size, site);
+        return addr;
+    }
+    return 0;
+}
+
+/*
+ * @brief Claim a cave named by a patch Target
+ *
+ * @returns false if it overlaps a cave that was already handed out or claimed
+ */
+bool cave_claim(cave_pool_t *pool, u64 addr, u32 size)
+{
+    for (u32 i = 0; i < pool->claim_count; i++)
+    {
+        if (range_overlaps(&pool->claim[i], addr, size))
+        {
+            final_printf("Code cave 0x%lx size %u overlaps cave 0x%lx size %lu\n", addr, size, pool->claim[i].addr, pool->claim[i].size);
+            return false;
+        }
+    }
+    cave_take(pool, addr, size);
+    range_add(&pool->claim, &pool->claim_count, addr, size);
+    return true;
+}
+
+/*
+ * @brief Keep the range of a patch write out of the free runs
+ *
+ * Writes can fill padding with NOPs or zeros, that space is not free. Pools
+ * are scanned before their module is first written, so an unscanned pool
+ * has no runs to take it from.
+ */
+void cave_reserve(cave_pool_t *pool, u64 addr, u32 size)
+{
+    cave_take(pool, addr, size);
+}
+
+/*
+ * @brief Give back a cave handed out by cave_alloc() or cave_claim()
+ *
+ * The caller restores its bytes, the space becomes a free run again.
+ */
+void cave_release(cave_pool_t *pool, u64 addr)
+{
+    for (u32 i = 0; i < pool->claim_count; i++)
+    {
+        if (pool->claim[i].addr != addr)
+        {
+            continue;
+        }
+        if (pool->scanned)
+        {
+            range_add(&pool->run, &pool->run_count, pool->claim[i].addr, pool->claim[i].size);
+        }
+        pool->claim[i] = pool->claim[--pool->claim_count];
+        return;
+    }
+}
+
+void cave_pool_free(cave_pool_t *pool)
+{
+    free(pool->run);
+    free(pool->claim);
+    memset(pool, 0, sizeof(*pool));
+}
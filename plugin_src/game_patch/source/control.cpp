@@ -0,0 +1,79 @@
+#include "control.h"
+#include "utils.h"
+
+/*
+ * @brief Start watching a control file
+ *
+ * Contents present when this is called are not reported by control_poll().
+ */
+void control_init(control_file_t *control, const char *path)
+{
+    memset(control, 0, sizeof(*control));
+    strncpy(control->path, path, sizeof(control->path) - 1);
+    OrbisKernelStat stat;
+    if (!sceKernelStat(control->path, &stat))
+    {
+        control->size = stat.st_size;
+        control->mtime_sec = stat.st_mtim.tv_sec;
+        control->mtime_nsec = stat.st_mtim.tv_nsec;
+    }
+}
+
+/*
+ * @brief Read the control file if it changed since the last poll
+ *
+ * Only one sceKernelStat() per poll while nothing changes.
+ *
+ * @returns Null terminated contents, free() after use, nullptr if unchanged or missing
+ */
+char *control_poll(control_file_t *control)
+{
+    OrbisKernelStat stat;
+    if (sceKernelStat(control->path, &stat))
+    {
+        return nullptr;
+    }
+    if ((u64)stat.st_size == control->size &&
+        (u64)stat.st_mtim.tv_sec == control->mtime_sec &&
+        (u64)stat.st_mtim.tv_nsec == control->mtime_nsec)
+    {
+        return nullptr;
+    }
+    control->size = stat.st_size;
+    control->mtime_sec = stat.st_mtim.tv_sec;
+    control->mtime_nsec = stat.st_mtim.tv_nsec;
+    char *buffer = nullptr;
+    u64 size = 0;
+    if (Read_File(control->path, &buffer, &size, 1) || !buffer)
+    {
+        free(buffer);
+        return nullptr;
+    }
+    buffer[size] = '\0';
+    return buffer;
+}
+
+/*
+ * @brief Split the next line off `*cursor`, blank lines and `#` comments are skipped
+ *
+ * @returns Line without its line break, nullptr at the end of the text
+ */
+char *control_next_line(char **cursor)
+{
+    while (**cursor)
+    {
+        char *line = *cursor;
+        char *end = line + strcspn(line, "\r\n");
+        *cursor = end + strspn(end, "\r\n");
+        *end = '\0';
+        while (*line == ' ' || *line == '\t')
+        {
+            line++;
+        }
+        if (line[0] && line[0] != '#')
+        {
+            return line;
+        }
+    }
+    return nullptr;
+}
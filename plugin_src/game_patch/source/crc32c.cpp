@@ -0,0 +1,139 @@
+#include "crc32c.h"
+
+#include <nmmintrin.h>
+
+// Tables are built by the compiler, so parallel scan workers never race to fill them
+struct crc32c_table_t
+{
+    u32 entry[256];
+};
+
+static constexpr crc32c_table_t crc32c_table_make(void)
+{
+    crc32c_table_t table = {};
+    for (u32 i = 0; i < 256; i++)
+    {
+        u32 c = i;
+        for (u32 j = 0; j < 8; j++)
+        {
+            c = (c >> 1) ^ (0x82f63b78 & (0 - (c & 1)));
+        }
+        table.entry[i] = c;
+    }
+    return table;
+}
+
+static constexpr crc32c_table_t crc32c_table = crc32c_table_make();
+
+static u32 crc32c_sw(u32 crc, const u8 *data, u64 size)
+{
+    for (u64 i = 0; i < size; i++)
+    {
+        crc = crc32c_table.entry[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+// Three independent streams hide the 3 cycle latency of crc32, they are combined with the table free shift below.
+#define CRC32C_BLOCK 8192
+
+// a * b mod P, bit reflected (zlib crc32_combine)
+static constexpr u32 crc32c_multmod(u32 a, u32 b)
+{
+    u32 m = 1u << 31;
+    u32 p = 0;
+    for (;;)
+    {
+        if (a & m)
+        {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+            {
+                break;
+            }
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ 0x82f63b78 : b >> 1;
+    }
+    return p;
+}
+
+// x^(8 * len) mod P
+static constexpr u32 crc32c_x8n(u64 len)
+{
+    u32 pow = 1u << 23; // x^8
+    u32 p = 1u << 31;   // x^0
+    for (; len; len >>= 1)
+    {
+        if (len & 1)
+        {
+            p = crc32c_multmod(pow, p);
+        }
+        pow = crc32c_multmod(pow, pow);
+    }
+    return p;
+}
+
+// shifts a stream over the CRC32C_BLOCK bytes after it
+static constexpr u32 crc32c_block_shift = crc32c_x8n(CRC32C_BLOCK);
+
+__attribute__((target("sse4.2")))
+static u32 crc32c_hw(u32 crc, const u8 *data, u64 size)
+{
+    u64 c0 = crc;
+    while (size && ((u64)data & 7))
+    {
+        c0 = _mm_crc32_u8((u32)c0, *data++);
+        size--;
+    }
+    // three interleaved blocks per round
+    while (size >= 3 * CRC32C_BLOCK)
+    {
+        u64 c1 = 0;
+        u64 c2 = 0;
+        const u64 *p0 = (const u64 *)data;
+        const u64 *p1 = (const u64 *)(data + CRC32C_BLOCK);
+        const u64 *p2 = (const u64 *)(data + 2 * CRC32C_BLOCK);
+        for (u32 i = 0; i < CRC32C_BLOCK / 8; i++)
+        {
+            c0 = _mm_crc32_u64(c0, p0[i]);
+            c1 = _mm_crc32_u64(c1, p1[i]);
+            c2 = _mm_crc32_u64(c2, p2[i]);
+        }
+        c0 = crc32c_multmod(crc32c_block_shift, (u32)c0) ^ (u32)c1;
+        c0 = crc32c_multmod(crc32c_block_shift, (u32)c0) ^ (u32)c2;
+        data += 3 * CRC32C_BLOCK;
+        size -= 3 * CRC32C_BLOCK;
+    }
+    while (size >= 8)
+    {
+        c0 = _mm_crc32_u64(c0, *(const u64 *)data);
+        data += 8;
+        size -= 8;
+    }
+    while (size--)
+    {
+        c0 = _mm_crc32_u8((u32)c0, *data++);
+    }
+    return (u32)c0;
+}
+
+/*
+ * @brief Update a CRC32C
+ *
+ * @param crc  0 to start, or the result of the previous call to continue
+ * @param data Data to add
+ * @param size Size of `data`
+ * @returns    Updated CRC32C
+ */
+u32 crc32c(u32 crc, const void *data, u64 size)
+{
+    crc = ~crc;
+#if defined(__linux__)
+    if (!__builtin_cpu_supports("sse4.2"))
+    {
+        return ~crc32c_sw(crc, (const u8 *)data, size);
+    }
+#endif
+    return ~crc32c_hw(crc, (const u8 *)data, size);
+}
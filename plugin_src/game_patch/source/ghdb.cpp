@@ -0,0 +1,84 @@
+#include "ghdb.h"
+#include "ghp.h"
+
+static bool read_at(s32 fd, u64 offset, void *data, u64 size)
+{
+    return sceKernelLseek(fd, offset, SEEK_SET) == (s64)offset &&
+           sceKernelRead(fd, data, size) == (s64)size;
+}
+
+/*
+ * @brief Read the compiled patch file of one title from a patch database
+ *
+ * The index is read in one go and searched by title id, then only the
+ * title's .ghp file is read.
+ *
+ * @param path     Database file
+ * @param titleid  Title to look up
+ * @param xml_size Only use the entry if it was built from an xml of this size, 0 to take any
+ * @param xml_crc  crc32c() of that xml, both have to match
+ * @param out      Compiled patch file, free() after use
+ * @param out_size Size of `out`
+ * @returns        false if the database is missing, outdated or has no entry for the title
+ */
+bool ghdb_load(const char *path, const char *titleid, u64 xml_size, u32 xml_crc, u8 **out, u64 *out_size)
+{
+    s32 fd = sceKernelOpen(path, 0, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool found = false;
+    ghdb_header_t header = {};
+    ghdb_title_t *index = nullptr;
+    const u64 file_size = sceKernelLseek(fd, 0, SEEK_END);
+    if (!read_at(fd, 0, &header, sizeof(header)) || header.magic != GHDB_MAGIC ||
+        header.version != GHDB_VERSION || header.ghp_version != GHP_VERSION ||
+        header.index_offset + (u64)header.title_count * sizeof(ghdb_title_t) > file_size)
+    {
+        final_printf("Patch database %s is invalid or from another version\n", path);
+        sceKernelClose(fd);
+        return false;
+    }
+    index = (ghdb_title_t *)malloc(header.title_count * sizeof(ghdb_title_t) + 1);
+    if (read_at(fd, header.index_offset, index, header.title_count * sizeof(ghdb_title_t)))
+    {
+        s32 lo = 0;
+        s32 hi = (s32)header.title_count - 1;
+        while (lo <= hi)
+        {
+            s32 mid = (lo + hi) / 2;
+            s32 cmp = ghdb_title_cmp(index[mid].titleid, titleid);
+            if (cmp == 0)
+            {
+                const ghdb_title_t *title = &index[mid];
+                if ((xml_size && (title->xml_size != xml_size || title->xml_crc != xml_crc)) || title->offset + title->size > file_size)
+                {
+                    debug_printf("Patch database entry for %s does not match its xml\n", titleid);
+                    break;
+                }
+                *out = (u8 *)malloc(title->size);
+                found = read_at(fd, title->offset, *out, title->size);
+                if (!found)
+                {
+                    free(*out);
+                    *out = nullptr;
+                }
+                *out_size = title->size;
+                break;
+            }
+            if (cmp < 0)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid - 1;
+            }
+        }
+    }
+    free(index);
+    sceKernelClose(fd);
+    debug_printf("Patch database %s: %s %s\n", path, titleid, found ? "found" : "not found");
+    return found;
+}
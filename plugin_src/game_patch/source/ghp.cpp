@@ -0,0 +1,308 @@
+#include <mxml.h>
+#include "ghp.h"
+#include "patch.h"
+
+static const char *GetXMLAttr(mxml_node_t *node, const char *name)
+{
+    const char* AttrData = mxmlElementGetAttr(node, name);
+    if (AttrData == NULL) AttrData = "";
+    return AttrData;
+}
+
+static s64 parse_mask_offset(const char *gameOffset)
+{
+    if (gameOffset[0] == '-')
+    {
+        return -(s64)strtoul(gameOffset + 1, NULL, 10);
+    }
+    else if (gameOffset[0] == '+')
+    {
+        return strtoul(gameOffset + 1, NULL, 10);
+    }
+    return 0;
+}
+
+u64 ghp_filter_hash(const char *app_elf, const char *app_ver)
+{
+    if (!app_elf || !app_ver)
+    {
+        return 0;
+    }
+    char filter[MAX_PATH_ + 16];
+    snprintf(filter, sizeof(filter), "%s/%s", app_elf, app_ver);
+    return djb2_hash(filter);
+}
+
+struct ghp_builder_t
+{
+    byte_buffer_t entries;
+    byte_buffer_t lines;
+    byte_buffer_t strings;
+    byte_buffer_t payload;
+    u32 entry_count;
+    u32 line_count;
+    u32 metadata_count;
+    ghp_entry_t entry;
+    bool in_entry;
+    u32 skip_depth; // > 0 while inside a Metadata subtree that is filtered out
+    const char *xml_path;
+    const char *app_elf;
+    const char *app_ver;
+};
+
+static void ghp_add_line(ghp_builder_t *builder, mxml_node_t *Line_node)
+{
+    const char *gameType = GetXMLAttr(Line_node, "Type");
+    const char *gameAddr = GetXMLAttr(Line_node, "Address");
+    const char *gameValue = GetXMLAttr(Line_node, "Value");
+
+    ghp_line_t line = {};
+    line.type_hash = djb2_hash(gameType);
+    // decoded straight into the payload pool
+    line.payload = builder->payload.size;
+    if (!patch_value_decode(line.type_hash, gameValue, &builder->payload, &line.payload_size))
+    {
+        final_printf("Patch type: %s not found or value invalid, line skipped\n", gameType);
+        return;
+    }
+    line.addr_str = buffer_append_string(&builder->strings, gameAddr);
+    // starts with `mask`
+    // mask or mask_jump32
+    if (!strncmp("mask", gameType, 4))
+    {
+        line.flags |= GHP_LINE_MASK;
+        line.offset = parse_mask_offset(GetXMLAttr(Line_node, "Offset"));
+        if (line.type_hash == djb2_hash("mask_jump32"))
+        {
+            line.target_str = buffer_append_string(&builder->strings, GetXMLAttr(Line_node, "Target"));
+            line.jump_size = strtoul(GetXMLAttr(Line_node, "Size"), NULL, 10);
+        }
+    }
+    else
+    {
+        line.addr = strtoull(gameAddr, NULL, 16);
+    }
+    buffer_append(&builder->lines, &line, sizeof(line));
+    builder->line_count++;
+}
+
+// Nodes are not retained, mxml frees each one once it is closed so the document is never held in memory.
+static void ghp_sax_cb(mxml_node_t *node, mxml_sax_event_t event, void *data)
+{
+    ghp_builder_t *builder = (ghp_builder_t *)data;
+    if (event != MXML_SAX_ELEMENT_OPEN && event != MXML_SAX_ELEMENT_CLOSE)
+    {
+        return;
+    }
+    if (builder->skip_depth)
+    {
+        builder->skip_depth += (event == MXML_SAX_ELEMENT_OPEN) ? 1 : -1;
+        return;
+    }
+    const char *element = mxmlGetElement(node);
+    if (!element)
+    {
+        return;
+    }
+    if (event == MXML_SAX_ELEMENT_CLOSE)
+    {
+        if (builder->in_entry && !strcmp(element, "Metadata"))
+        {
+            builder->entry.line_count = builder->line_count - builder->entry.first_line;
+            buffer_append(&builder->entries, &builder->entry, sizeof(builder->entry));
+            builder->entry_count++;
+            builder->in_entry = false;
+        }
+        return;
+    }
+    if (!strcmp(element, "Metadata"))
+    {
+        const char *TitleData = GetXMLAttr(node, "Title");
+        const char *NameData = GetXMLAttr(node, "Name");
+        const char *AppVerData = GetXMLAttr(node, "AppVer");
+        const char *AppElfData = GetXMLAttr(node, "AppElf");
+        const char *AppFingerprintData = GetXMLAttr(node, "AppFingerprint");
+        builder->metadata_count++;
+        // entries with a fingerprint are checked when the game starts
+        if (builder->app_elf && (strcmp(builder->app_elf, AppElfData) || !app_ver_matches(builder->app_ver, AppVerData, AppFingerprintData[0])))
+        {
+            // closing tag of this element brings the depth back to 0
+            builder->skip_depth = 1;
+            return;
+        }
+        ghp_entry_t *entry = &builder->entry;
+        memset(entry, 0, sizeof(*entry));
+        entry->settings_hash = patch_hash_calc(TitleData, NameData, AppVerData, builder->xml_path, AppElfData);
+        entry->title = buffer_append_string(&builder->strings, TitleData);
+        entry->name = buffer_append_string(&builder->strings, NameData);
+        entry->app_ver = buffer_append_string(&builder->strings, AppVerData);
+        entry->app_elf = buffer_append_string(&builder->strings, AppElfData);
+        entry->module = buffer_append_string(&builder->strings, GetXMLAttr(node, "Module"));
+        entry->first_line = builder->line_count;
+        if (AppFingerprintData[0])
+        {
+            entry->flags |= GHP_ENTRY_FINGERPRINT;
+            entry->app_fingerprint = strtoul(AppFingerprintData, NULL, 16);
+        }
+        const char *EarlyData = GetXMLAttr(node, "Early");
+        if (EarlyData[0] == '1' || !strcasecmp(EarlyData, "true"))
+        {
+            entry->flags |= GHP_ENTRY_EARLY;
+        }
+        builder->in_entry = true;
+    }
+    else if (builder->in_entry && !strcmp(element, "Line"))
+    {
+        ghp_add_line(builder, node);
+    }
+}
+
+// Set by mxml on any parse error. mxmlSAXLoadString() returns NULL when no node is retained, so its result can't tell.
+// mxml keeps the error callback per thread, and tools/patch_db compiles on several threads, so the flag is too.
+static thread_local bool ghp_parse_error;
+
+static void ghp_error_cb(const char *message)
+{
+    final_printf("XML: %s\n", message);
+    ghp_parse_error = true;
+}
+
+/*
+ * @brief Compile a patch xml to the .ghp format
+ *
+ * The xml is read with mxml's SAX interface. With a filter, Metadata entries
+ * whose AppElf/AppVer can't match are skipped on their start tag, without
+ * visiting their lines. Without one every entry is kept and matching is
+ * left to the loader.
+ *
+ * @param xml       Null terminated xml text
+ * @param xml_path  Path of the xml, part of the settings hash
+ * @param app_elf   Only keep entries for this executable, NULL to keep all
+ * @param app_ver   Only keep entries for this app version, NULL to keep all
+ * @param xml_size  Size of the xml file
+ * @param xml_mtime Modification time of the xml file
+ * @param out       Compiled file, free() after use
+ * @param out_size  Size of the compiled file
+ * @returns         false if the xml could not be parsed
+ */
+bool ghp_compile(const char *xml, const char *xml_path, const char *app_elf, const char *app_ver,
+                 u64 xml_size, u64 xml_mtime, u8 **out, u64 *out_size)
+{
+    ghp_builder_t builder = {};
+    builder.xml_path = xml_path;
+    builder.app_elf = app_ver ? app_elf : NULL;
+    builder.app_ver = app_elf ? app_ver : NULL;
+    buffer_append(&builder.strings, "", 1);
+
+    ghp_parse_error = false;
+    mxmlSetErrorCallback(ghp_error_cb);
+    mxml_node_t *tree = mxmlSAXLoadString(NULL, xml, MXML_NO_CALLBACK, ghp_sax_cb, &builder);
+    mxmlSetErrorCallback(NULL);
+    if (tree)
+    {
+        mxmlDelete(tree);
+    }
+    if (ghp_parse_error)
+    {
+        final_printf("XML: could not parse XML:\n%s\n", xml);
+        buffer_free(&builder.entries);
+        buffer_free(&builder.lines);
+        buffer_free(&builder.strings);
+        buffer_free(&builder.payload);
+        return false;
+    }
+
+    ghp_header_t header = {};
+    header.magic = GHP_MAGIC;
+    header.version = GHP_VERSION;
+    header.xml_size = xml_size;
+    header.xml_mtime = xml_mtime;
+    header.filter_hash = ghp_filter_hash(builder.app_elf, builder.app_ver);
+    header.entry_count = builder.entry_count;
+    header.line_count = builder.line_count;
+    header.entries_offset = sizeof(header);
+    header.lines_offset = header.entries_offset + builder.entries.size;
+    header.strings_offset = header.lines_offset + builder.lines.size;
+    header.strings_size = builder.strings.size;
+    header.payload_offset = header.strings_offset + builder.strings.size;
+    header.payload_size = builder.payload.size;
+
+    byte_buffer_t file = {};
+    buffer_append(&file, &header, sizeof(header));
+    buffer_append(&file, builder.entries.data, builder.entries.size);
+    buffer_append(&file, builder.lines.data, builder.lines.size);
+    buffer_append(&file, builder.strings.data, builder.strings.size);
+    buffer_append(&file, builder.payload.data, builder.payload.size);
+    buffer_free(&builder.entries);
+    buffer_free(&builder.lines);
+    buffer_free(&builder.strings);
+    buffer_free(&builder.payload);
+
+    debug_printf("Compiled %u of %u entries, %u lines, %u bytes\n", builder.entry_count, builder.metadata_count,
+                 builder.line_count, file.size);
+    *out = file.data;
+    *out_size = file.size;
+    return true;
+}
+
+/*
+ * @brief Validate a compiled patch file and set up its tables
+ *
+ * @param ghp  Output
+ * @param data File contents, owned by `ghp` on success
+ * @param size Size of `data`
+ * @returns    false if the file is invalid or from another format version
+ */
+bool ghp_open(ghp_t *ghp, u8 *data, u64 size)
+{
+    const ghp_header_t *header = (const ghp_header_t *)data;
+    if (size < sizeof(*header) || header->magic != GHP_MAGIC || header->version != GHP_VERSION)
+    {
+        return false;
+    }
+    if ((u64)header->entries_offset + (u64)header->entry_count * sizeof(ghp_entry_t) > size ||
+        (u64)header->lines_offset + (u64)header->line_count * sizeof(ghp_line_t) > size ||
+        (u64)header->strings_offset + header->strings_size > size ||
+        (u64)header->payload_offset + header->payload_size > size ||
+        !header->strings_size || data[header->strings_offset + header->strings_size - 1] != '\0')
+    {
+        final_printf("Compiled patch file is truncated\n");
+        return false;
+    }
+    const ghp_entry_t *entry = (const ghp_entry_t *)(data + header->entries_offset);
+    const ghp_line_t *line = (const ghp_line_t *)(data + header->lines_offset);
+    for (u32 i = 0; i < header->entry_count; i++)
+    {
+        if ((u64)entry[i].first_line + entry[i].line_count > header->line_count ||
+            entry[i].title >= header->strings_size || entry[i].name >= header->strings_size ||
+            entry[i].app_ver >= header->strings_size || entry[i].app_elf >= header->strings_size ||
+            entry[i].module >= header->strings_size)
+        {
+            final_printf("Compiled patch file entry %u is invalid\n", i);
+            return false;
+        }
+    }
+    for (u32 i = 0; i < header->line_count; i++)
+    {
+        if ((u64)line[i].payload + line[i].payload_size > header->payload_size ||
+            line[i].addr_str >= header->strings_size || line[i].target_str >= header->strings_size)
+        {
+            final_printf("Compiled patch file line %u is invalid\n", i);
+            return false;
+        }
+    }
+    ghp->data = data;
+    ghp->size = size;
+    ghp->header = header;
+    ghp->entry = entry;
+    ghp->line = line;
+    ghp->strings = (const char *)(data + header->strings_offset);
+    ghp->payload = data + header->payload_offset;
+    return true;
+}
+
+void ghp_free(ghp_t *ghp)
+{
+    free(ghp->data);
+    ghp->data = nullptr;
+}
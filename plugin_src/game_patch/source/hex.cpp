@@ -0,0 +1,116 @@
+#include "hex.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static inline bool hex_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// nibble value, -1 if `c` is not a hex digit
+static inline s32 hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/*
+ * @brief Decode a hex string, whitespace between digits is skipped
+ *
+ * Blocks of 16 hex digits are validated and decoded with SSE2, anything
+ * else goes through the scalar path. An odd number of digits is read as if
+ * it had a leading 0, as the old decoder did.
+ *
+ * @param str       Hex string
+ * @param len       Length of `str`
+ * @param out       Output, at least hex_decoded_max(len) bytes
+ * @param out_size  Bytes written
+ * @param error_pos Position of the first invalid character on failure
+ * @returns         false if `str` has a character that is neither a hex digit nor whitespace
+ */
+bool hex_decode(const char *str, u64 len, u8 *out, u64 *out_size, u64 *error_pos)
+{
+    u64 i = 0;
+    u64 n = 0;
+    s32 pending = -1; // high nibble waiting for its low nibble
+#if defined(__SSE2__)
+    const __m128i lo0 = _mm_set1_epi8('0' - 1);
+    const __m128i hi9 = _mm_set1_epi8('9' + 1);
+    const __m128i loa = _mm_set1_epi8('a' - 1);
+    const __m128i hif = _mm_set1_epi8('f' + 1);
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i low4 = _mm_set1_epi8(0x0f);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i low8 = _mm_set1_epi16(0x00ff);
+#endif
+    while (i < len)
+    {
+#if defined(__SSE2__)
+        if (pending < 0 && i + 16 <= len)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(str + i));
+            __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, lo0), _mm_cmplt_epi8(v, hi9));
+            __m128i lower = _mm_or_si128(v, case_bit);
+            __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, loa), _mm_cmplt_epi8(lower, hif));
+            if (_mm_movemask_epi8(_mm_or_si128(digit, alpha)) == 0xffff)
+            {
+                // '0'-'9' -> 0-9, 'a'-'f' and 'A'-'F' -> 1-6 + 9
+                __m128i value = _mm_add_epi8(_mm_and_si128(v, low4), _mm_andnot_si128(digit, nine));
+                // even characters are high nibbles, odd ones low nibbles
+                __m128i high = _mm_slli_epi16(_mm_and_si128(value, low8), 4);
+                __m128i low = _mm_srli_epi16(value, 8);
+                __m128i bytes = _mm_packus_epi16(_mm_or_si128(high, low), _mm_setzero_si128());
+                _mm_storel_epi64((__m128i *)(out + n), bytes);
+                n += 8;
+                i += 16;
+                continue;
+            }
+        }
+#endif
+        char c = str[i];
+        s32 nibble = hex_nibble(c);
+        if (nibble < 0)
+        {
+            if (!hex_space(c))
+            {
+                *error_pos = i;
+                *out_size = 0;
+                return false;
+            }
+        }
+        else if (pending < 0)
+        {
+            pending = nibble;
+        }
+        else
+        {
+            out[n++] = (u8)((pending << 4) | nibble);
+            pending = -1;
+        }
+        i++;
+    }
+    if (pending >= 0)
+    {
+        // odd digit count, shift everything right by one nibble
+        u8 carry = 0;
+        for (u64 j = 0; j < n; j++)
+        {
+            u8 b = out[j];
+            out[j] = (u8)((carry << 4) | (b >> 4));
+            carry = b & 0x0f;
+        }
+        out[n++] = (u8)((carry << 4) | pending);
+    }
+    *out_size = n;
+    return true;
+}
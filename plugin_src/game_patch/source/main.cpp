@@ -2,20 +2,37 @@
 // Author: illusion0001 @ https://github.com/illusion0001
 // Repository: https://github.com/GoldHEN/GoldHEN_Plugins_Repository
 
-#include <mxml.h>
+#include "cache.h"
+#include "control.h"
+#include "crc32c.h"
+#include "ghdb.h"
+#include "ghp.h"
+#include "module.h"
 #include "patch.h"
+#include "profile.h"
+#include "scan.h"
+#include "search.h"
+#include "settings.h"
+#include "thread.h"
 #include "utils.h"
 
 #define GOLDHEN_PATH_ (const char*) GOLDHEN_PATH
 #define BASE_PATH_PATCH (const char*) GOLDHEN_PATH_ "/patches"
 #define BASE_PATH_PATCH_SETTINGS (const char*) BASE_PATH_PATCH "/settings"
 #define BASE_PATH_PATCH_XML (const char*) BASE_PATH_PATCH "/xml"
+#define BASE_PATH_PATCH_CACHE (const char*) BASE_PATH_PATCH "/cache"
+#define BASE_PATH_PATCH_OPTIONS (const char*) BASE_PATH_PATCH "/options"
+#define BASE_PATH_PATCH_SETTINGS_INDEX (const char*) BASE_PATH_PATCH_CACHE "/settings.bin"
+#define BASE_PATH_PATCH_CONTROL (const char*) BASE_PATH_PATCH "/control.txt"
+#define BASE_PATH_PATCH_SEARCH (const char*) BASE_PATH_PATCH "/search.txt"
+#define BASE_PATH_PATCH_DB (const char*) BASE_PATH_PATCH "/patches.ghdb"
 #define PLUGIN_NAME (const char*) "game_patch"
 #define PLUGIN_DESC (const char*) "Patches game at boot"
 #define PLUGIN_AUTH (const char*) "illusion"
 #define PLUGIN_VER 0x110 // 1.10
 
 #define NO_ASLR_ADDR 0x00400000
+#define SEARCH_RESULTS_MAX 256 // addresses written to BASE_PATH_PATCH_SEARCH
 
 attr_public const char *g_pluginName = PLUGIN_NAME;
 attr_public const char *g_pluginDesc = PLUGIN_DESC;
@@ -29,323 +46,1142 @@ char game_ver[8] = {0};
 
 u64 module_base = 0;
 u32 module_size = 0;
-// unused for now
-u64 PRX_module_base = 0;
-u32 PRX_module_size = 0;
+module_map_t g_modules = {};
 
-const char* GetXMLAttr(mxml_node_t *node, const char *name)
+// Plugin options are files in BASE_PATH_PATCH_OPTIONS, enabled when they start with '1'
+static bool option_enabled(const char *name)
 {
-    const char* AttrData = mxmlElementGetAttr(node, name);
-    if (AttrData == NULL) AttrData = "";
-    return AttrData;
+    char path[MAX_PATH_];
+    char *buffer = nullptr;
+    u64 size = 0;
+    snprintf(path, sizeof(path), BASE_PATH_PATCH_OPTIONS "/%s.txt", name);
+    bool enabled = !Read_File(path, &buffer, &size, 0) && buffer[0] == '1';
+    free(buffer);
+    debug_printf("Option %s: %u\n", name, enabled);
+    return enabled;
 }
 
-constexpr u32 MAX_PATTERN_LENGTH = 256;
+// Numeric plugin options, `fallback` if the file is missing or empty
+static u32 option_u32(const char *name, u32 fallback)
+{
+    char path[MAX_PATH_];
+    char *buffer = nullptr;
+    u64 size = 0;
+    snprintf(path, sizeof(path), BASE_PATH_PATCH_OPTIONS "/%s.txt", name);
+    u32 value = fallback;
+    if (!Read_File(path, &buffer, &size, 1))
+    {
+        buffer[size] = '\0';
+        char *end = nullptr;
+        u32 parsed = strtoul(buffer, &end, 10);
+        if (end != buffer)
+        {
+            value = parsed;
+        }
+    }
+    free(buffer);
+    debug_printf("Option %s: %u\n", name, value);
+    return value;
+}
 
-s32 pattern_to_byte(const char* pattern, uint8_t* bytes)
+struct patch_line_t
 {
-    s32 count = 0;
-    const char* start = pattern;
-    const char* end = pattern + strlen(pattern);
+    const ghp_line_t *src;
+    u32 module;     // index into g_modules
+    u32 entry;      // index of the entry in the patch file
+    const char *owner; // name of the patch
+    u64 addr;       // absolute address, used when addr_sig < 0
+    s32 addr_sig;   // index into the signature table, -1 for plain addresses
+    s32 target_sig; // mask_jump32 code cave signature, -1 if unused
+    u64 jump_addr;  // mask_jump32 code cave, 0 until its Target is resolved or a cave is handed out
+};
 
-    for (const char* current = start; current < end; ++current)
+struct patch_list_t
+{
+    patch_line_t *line;
+    u32 size;
+};
+
+static patch_line_t *patch_list_add(patch_list_t *list)
+{
+    if ((list->size % 32) == 0)
     {
-        if (*current == ' ')
-            continue;
+        list->line = (patch_line_t *)realloc(list->line, (32 + list->size) * sizeof(patch_line_t));
+    }
+    patch_line_t *line = &list->line[list->size++];
+    memset(line, 0, sizeof(*line));
+    line->addr_sig = -1;
+    line->target_sig = -1;
+    return line;
+}
+
+// title entry of the patch database, `xml_size` 0 takes it whatever xml it was built from
+static bool load_patch_db(ghp_t *ghp, u64 xml_size, u32 xml_crc)
+{
+    u8 *data = nullptr;
+    u64 size = 0;
+    u64 start = profile_now();
+    bool found = ghdb_load(BASE_PATH_PATCH_DB, titleid, xml_size, xml_crc, &data, &size);
+    profile_add(PROF_FILE_IO, start);
+    if (!found)
+    {
+        return false;
+    }
+    if (!ghp_open(ghp, data, size))
+    {
+        free(data);
+        return false;
+    }
+    debug_printf("Using patch database %s\n", BASE_PATH_PATCH_DB);
+    return true;
+}
 
-        if (*current == '?')
+/*
+ * @brief Load the compiled patch file of the title, rebuild it from the xml if it is stale
+ *
+ * The patch database is used when the title has no xml, or when its entry
+ * was built from the same xml, compared by size and CRC32C, and there is no
+ * fresh .ghp file. A matching entry is saved as the .ghp file, so later
+ * boots neither read the xml nor the database.
+ */
+static bool load_patch_file(ghp_t *ghp, const char *input_file, const char *ghp_file)
+{
+    OrbisKernelStat xml_stat;
+    s32 res = sceKernelStat(input_file, &xml_stat);
+    if (res) {
+        if (load_patch_db(ghp, 0, 0))
         {
-            ++current;
-            if (*current == '?')
-            {
-                ++current;
-            }
-            bytes[count++] = -1;
+            return true;
         }
-        else
+        final_printf("file %s not found\nerror: 0x%08x", input_file, res);
+        return false;
+    }
+    const u64 xml_size = xml_stat.st_size;
+    const u64 xml_mtime = xml_stat.st_mtim.tv_sec;
+
+    char *buffer = nullptr;
+    u64 size = 0;
+    u64 start = profile_now();
+    s32 ghp_res = Read_File(ghp_file, &buffer, &size, 0);
+    profile_add(PROF_FILE_IO, start);
+    if (!ghp_res)
+    {
+        // database entries are unfiltered, they hold the entries of every executable
+        if (ghp_open(ghp, (u8 *)buffer, size) &&
+            ghp->header->xml_size == xml_size &&
+            ghp->header->xml_mtime == xml_mtime &&
+            (!ghp->header->filter_hash || ghp->header->filter_hash == ghp_filter_hash(game_elf, game_ver)))
         {
-            bytes[count++] = strtoul(current, (char**)&current, 16);
+            debug_printf("Using compiled patch file %s\n", ghp_file);
+            return true;
         }
+        final_printf("Compiled patch file %s is out of date\n", ghp_file);
+        free(buffer);
+        buffer = nullptr;
+    }
+
+    start = profile_now();
+    res = Read_File(input_file, &buffer, &size, 1);
+    profile_add(PROF_FILE_IO, start);
+    if (res || !buffer) {
+        final_printf("file %s not found\nerror: 0x%08x", input_file, res);
+        return false;
+    }
+    buffer[size] = '\0';
+    // the database entry is only taken for the same xml, a size match alone misses edits
+    if (load_patch_db(ghp, xml_size, crc32c(0, buffer, size)))
+    {
+        free(buffer);
+        // built on a PC, the local mtime makes it pass the .ghp check above
+        ghp_header_t *header = (ghp_header_t *)ghp->data;
+        header->xml_size = xml_size;
+        header->xml_mtime = xml_mtime;
+        start = profile_now();
+        Write_File(ghp_file, ghp->data, ghp->size);
+        profile_add(PROF_FILE_IO, start);
+        return true;
+    }
+    u8 *compiled = nullptr;
+    u64 compiled_size = 0;
+    start = profile_now();
+    bool ok = ghp_compile(buffer, input_file, game_elf, game_ver, xml_size, xml_mtime, &compiled, &compiled_size);
+    profile_add(PROF_PARSE, start);
+    free(buffer);
+    if (!ok)
+    {
+        return false;
+    }
+    start = profile_now();
+    Write_File(ghp_file, compiled, compiled_size);
+    profile_add(PROF_FILE_IO, start);
+    return ghp_open(ghp, compiled, compiled_size);
+}
+
+enum patch_phase_t
+{
+    PHASE_ALL,    // every enabled entry
+    PHASE_EARLY,  // entries marked Early, applied before module_start() returns
+    PHASE_LATE,   // the rest, applied by the worker thread
+    PHASE_MODULE, // deferred entries of a module that was just loaded
+};
+
+enum entry_state_t
+{
+    ENTRY_OFF,      // for another executable
+    ENTRY_DISABLED, // for this executable, disabled in its settings or at runtime
+    ENTRY_PENDING,  // enabled, not applied yet
+    ENTRY_DEFERRED, // waiting for its module to be loaded
+    ENTRY_APPLIED,
+};
+
+// Modules with deferred entries, sorted by name hash
+struct deferred_module_t
+{
+    u64 name_hash;
+    u32 count; // deferred entries
+};
+
+struct deferred_index_t
+{
+    deferred_module_t *module;
+    u32 size;
+};
+
+// Cave used by an entry, released when the entry is disabled at runtime
+struct live_cave_t
+{
+    u64 addr;
+    u32 module;
+    u32 entry;
+};
+
+struct patch_session_t
+{
+    ghp_t ghp;
+    u8 *state; // entry_state_t per entry
+    deferred_index_t deferred;
+    write_mode_t write_mode;
+    u32 scan_threads;    // option `scan_threads`: signature scan threads, 1 by default
+    bool live;           // option `live_patches`: keep the session to toggle entries at runtime
+    undo_log_t undo;     // live: bytes replaced by each entry, tagged with the entry index
+    live_cave_t *caves;  // live: caves of applied entries
+    u32 cave_count;
+    bool profile_log;    // option `profile`: append timings to PROFILE_LOG_PATH
+    bool profile_notify; // option `profile_notify`: add timings to the notification
+    u32 matched; // entries for this executable, enabled or not
+    u32 cave_lines; // mask_jump32 lines without a Target in those entries, modules are scanned for caves if any
+    u32 patch_items;
+    u32 patch_lines;
+};
+
+patch_session_t g_session = {};
+OrbisPthread g_patch_thread = nullptr;
+// guards g_session and g_modules once the load hook or the worker can run
+OrbisPthreadMutex g_patch_mutex = nullptr;
+// Handles of modules loaded while g_patch_mutex was held, added to the map
+// by whoever holds it next so the load hook never waits for a phase
+struct loaded_queue_t
+{
+    s32 *handle;
+    u32 size;
+};
+loaded_queue_t g_loaded = {};
+OrbisPthreadMutex g_loaded_mutex = nullptr; // guards g_loaded only
+// set while g_session holds entries that are not applied yet
+volatile bool g_session_live = false;
+// set while the worker has late entries to apply
+bool g_late_pending = false;
+// control file thread, runs with the `live_patches` or `value_search` option
+thread_t g_control_thread = {};
+bool g_control_started = false;
+volatile bool g_control_stop = false;
+u32 g_control_poll_ms = 500; // option `live_poll_ms`
+bool g_value_search = false;
+// owned by the control thread
+search_t g_search = {};
+
+HOOK_INIT(sceKernelLoadStartModule);
+
+static const char *phase_name(patch_phase_t phase)
+{
+    switch (phase)
+    {
+        case PHASE_EARLY: return "early";
+        case PHASE_LATE: return "late";
+        case PHASE_MODULE: return "module";
+        default: return "all";
     }
-    return count;
 }
 
 /*
- * @brief Scan for a given byte pattern on a module
- *
- * @param module_base Base of the module to search
- * @param module_size Size of the module to search
- * @param signature   IDA-style byte array pattern
- * @credit            https://github.com/OneshotGH/CSGOSimple-master/blob/59c1f2ec655b2fcd20a45881f66bbbc9cd0e562e/CSGOSimple/helpers/utils.cpp#L182
- * @returns           Address of the first occurrence
+ * @brief Load patch file and settings, mark the entries that apply to the running executable
+ * @returns Number of enabled entries
  */
-u8* PatternScan(uint64_t module_base, uint32_t module_size, const char* signature)
+static u32 patch_session_init(patch_session_t *session)
 {
-    if (!module_base || !module_size)
+    char input_file[MAX_PATH_];
+    char ghp_file[MAX_PATH_];
+    snprintf(input_file, sizeof(input_file), BASE_PATH_PATCH_XML "/%s.xml", titleid);
+    snprintf(ghp_file, sizeof(ghp_file), BASE_PATH_PATCH_CACHE "/%s.ghp", titleid);
+
+    if (!load_patch_file(&session->ghp, input_file, ghp_file))
     {
-        return nullptr;
+        return 0;
     }
-    u8 patternBytes[MAX_PATTERN_LENGTH];
-    s32 patternLength = pattern_to_byte(signature, patternBytes);
-    if (!patternLength || patternLength >= MAX_PATTERN_LENGTH)
-    {
-        final_printf("Pattern length too large or invalid! %i (0x%08x)\n", patternLength, patternLength);
-        final_printf("Input Pattern %s\n", signature);
-        return nullptr;
+    const ghp_t *ghp = &session->ghp;
+    session->state = (u8 *)calloc(ghp->header->entry_count + 1, sizeof(u8));
+    session->write_mode = option_enabled("direct_write") ? WRITE_MODE_DIRECT : WRITE_MODE_PROC_RW;
+    session->scan_threads = option_u32("scan_threads", 1);
+    session->live = option_enabled("live_patches");
+    session->profile_log = option_enabled("profile");
+    session->profile_notify = option_enabled("profile_notify");
+
+    u64 start = profile_now();
+    settings_t settings;
+    settings_load(&settings, BASE_PATH_PATCH_SETTINGS_INDEX, BASE_PATH_PATCH_SETTINGS);
+    u32 enabled = 0;
+    for (u32 i = 0; i < ghp->header->entry_count; i++) {
+        const ghp_entry_t *entry = &ghp->entry[i];
+        const char *AppVerData = ghp_string(ghp, entry->app_ver);
+        const char *AppElfData = ghp_string(ghp, entry->app_elf);
+
+        debug_printf("Title: \"%s\"\n", ghp_string(ghp, entry->title));
+        debug_printf("Name: \"%s\"\n", ghp_string(ghp, entry->name));
+        debug_printf("AppVer: \"%s\"\n", AppVerData);
+        debug_printf("AppElf: \"%s\"\n", AppElfData);
+
+        // only patches for this executable need their settings, files are only checked once the folder changed
+        const bool has_fingerprint = (entry->flags & GHP_ENTRY_FINGERPRINT) != 0;
+        bool app_match = !strcmp(game_elf, AppElfData) && app_ver_matches(game_ver, AppVerData, has_fingerprint);
+        if (app_match && has_fingerprint && entry->app_fingerprint != module_crc32c(&g_modules.module[0]))
+        {
+            final_printf("AppFingerprint 0x%08x != 0x%08x\n", entry->app_fingerprint, module_crc32c(&g_modules.module[0]));
+            app_match = false;
+        }
+        if (!app_match)
+        {
+            continue;
+        }
+        session->matched++;
+        for (u32 j = 0; j < entry->line_count; j++)
+        {
+            const ghp_line_t *line = &ghp->line[entry->first_line + j];
+            session->cave_lines += line->type_hash == djb2_hash("mask_jump32") && !line->target_str;
+        }
+        if (settings_enabled(&settings, entry->settings_hash, BASE_PATH_PATCH_SETTINGS))
+        {
+            session->state[i] = ENTRY_PENDING;
+            enabled++;
+        }
+        else
+        {
+            session->state[i] = ENTRY_DISABLED;
+        }
     }
-    u8* scanBytes = (uint8_t*)module_base;
+    debug_printf("%u of %u settings files checked, %u read\n", settings.files_checked, session->matched, settings.files_read);
+    settings_save(&settings, BASE_PATH_PATCH_SETTINGS_INDEX, BASE_PATH_PATCH_SETTINGS);
+    settings_free(&settings);
+    profile_add(PROF_SETTINGS, start);
+    return enabled;
+}
+
+static void patch_session_free(patch_session_t *session)
+{
+    ghp_free(&session->ghp);
+    free(session->state);
+    session->state = nullptr;
+    free(session->deferred.module);
+    session->deferred.module = nullptr;
+    session->deferred.size = 0;
+    undo_log_free(&session->undo);
+    free(session->caves);
+    session->caves = nullptr;
+    session->cave_count = 0;
+}
 
-    for (u64 i = 0; i < module_size; ++i)
+static s32 deferred_find(const deferred_index_t *index, u64 name_hash)
+{
+    s32 lo = 0;
+    s32 hi = (s32)index->size - 1;
+    while (lo <= hi)
     {
-        bool found = true;
-        for (s32 j = 0; j < patternLength; ++j)
+        s32 mid = (lo + hi) / 2;
+        if (index->module[mid].name_hash == name_hash)
         {
-            if (scanBytes[i + j] != patternBytes[j] && patternBytes[j] != 0xff)
-            {
-                found = false;
-                break;
-            }
+            return mid;
         }
-        if (found)
+        if (index->module[mid].name_hash < name_hash)
         {
-            return &scanBytes[i];
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid - 1;
         }
     }
-    return nullptr;
+    return -(lo + 1);
 }
 
-void get_key_init(void)
+static void deferred_add(deferred_index_t *index, u64 name_hash)
 {
-    u32 patch_lines = 0;
-    u32 patch_items = 0;
-    char *buffer = nullptr;
-    char *buffer2 = nullptr;
-    u64 size = 0;
-    u64 size2 = 0;
-    char input_file[MAX_PATH_];
-    snprintf(input_file, sizeof(input_file), BASE_PATH_PATCH_XML "/%s.xml", titleid);
-    s32 res = Read_File(input_file, &buffer, &size, 0);
+    s32 pos = deferred_find(index, name_hash);
+    if (pos >= 0)
+    {
+        index->module[pos].count++;
+        return;
+    }
+    pos = -(pos + 1);
+    if ((index->size % 16) == 0)
+    {
+        index->module = (deferred_module_t *)realloc(index->module, (16 + index->size) * sizeof(deferred_module_t));
+    }
+    memmove(&index->module[pos + 1], &index->module[pos], (index->size - pos) * sizeof(deferred_module_t));
+    index->module[pos].name_hash = name_hash;
+    index->module[pos].count = 1;
+    index->size++;
+}
 
-    if (res) {
-        final_printf("file %s not found\nerror: 0x%08x", input_file, res);
+static void deferred_remove(deferred_index_t *index, u64 name_hash)
+{
+    s32 pos = deferred_find(index, name_hash);
+    if (pos < 0)
+    {
         return;
     }
+    memmove(&index->module[pos], &index->module[pos + 1], (index->size - pos - 1) * sizeof(deferred_module_t));
+    index->size--;
+}
 
-    if (buffer) {
-        mxml_node_t *node, *tree = NULL;
-        tree = mxmlLoadString(NULL, buffer, MXML_NO_CALLBACK);
+// One deferred entry of the module was disabled, the module is dropped with its last entry
+static void deferred_release(deferred_index_t *index, u64 name_hash)
+{
+    s32 pos = deferred_find(index, name_hash);
+    if (pos >= 0 && --index->module[pos].count == 0)
+    {
+        deferred_remove(index, name_hash);
+    }
+}
 
-        if (!tree) {
-            final_printf("XML: could not parse XML:\n%s\n", buffer);
-            free(buffer);
-            return;
-        }
+/*
+ * @brief Resolve the signatures of one module, offsets are cached per title and module
+ */
+static void resolve_module_signatures(const patch_session_t *session, module_entry_t *module, sig_table_t *sigs)
+{
+    u64 start = profile_now();
+    const bool main_module = module == &g_modules.module[0];
+    // cached offsets are dropped when the module changes
+    char cache_path[MAX_PATH_];
+    if (main_module)
+    {
+        snprintf(cache_path, sizeof(cache_path), BASE_PATH_PATCH_CACHE "/%s.bin", titleid);
+    }
+    else
+    {
+        snprintf(cache_path, sizeof(cache_path), BASE_PATH_PATCH_CACHE "/%s_%016lx.bin", titleid, module->name_hash);
+    }
+    if (!module->fingerprint)
+    {
+        module->fingerprint = module_fingerprint(module_crc32c(module), main_module ? game_elf : module->name, game_ver);
+    }
+    sig_cache_t cache;
+    sig_cache_load(&cache, cache_path, module->fingerprint);
+    u32 hits = sig_cache_apply(&cache, sigs, module->base);
+    final_printf("Signature cache: %u of %u signatures cached for %s\n", hits, sigs->size, module->name);
+    g_profile.patterns += sigs->size;
+    g_profile.patterns_cached += hits;
+    if (hits < sigs->size)
+    {
+        g_profile.bytes_scanned += module_resolve_signatures(module, sigs, session->scan_threads);
+        sig_cache_update(&cache, sigs, module->base);
+        sig_cache_save(&cache, cache_path);
+    }
+    sig_cache_free(&cache);
+    for (u32 i = 0; i < sigs->size; i++)
+    {
+        g_profile.patterns_resolved += sigs->entry[i].result != 0;
+    }
+    profile_add(PROF_SCAN, start);
+}
 
-        for (node = mxmlFindElement(tree, tree, "Metadata", NULL, NULL, MXML_DESCEND); node != NULL;
-             node = mxmlFindElement(node, tree, "Metadata", NULL, NULL, MXML_DESCEND)) {
-            bool PRX_patch = false;
-            const char *TitleData = GetXMLAttr(node, "Title");
-            const char *NameData = GetXMLAttr(node, "Name");
-            const char *AppVerData = GetXMLAttr(node, "AppVer");
-            const char *AppElfData = GetXMLAttr(node, "AppElf");
-
-            debug_printf("Title: \"%s\"\n", TitleData);
-            debug_printf("Name: \"%s\"\n", NameData);
-            debug_printf("AppVer: \"%s\"\n", AppVerData);
-            debug_printf("AppElf: \"%s\"\n", AppElfData);
-
-            u64 hashout = patch_hash_calc(TitleData, NameData, AppVerData, input_file, AppElfData);
-            char settings_path[MAX_PATH_];
-            snprintf(settings_path, sizeof(settings_path), BASE_PATH_PATCH_SETTINGS "/0x%016lx.txt", hashout);
-            final_printf("Settings path: %s\n", settings_path);
-            s32 res = Read_File(settings_path, &buffer2, &size2, 0);
-            if (res == ORBIS_KERNEL_ERROR_ENOENT) {
-                debug_printf("file %s not found, initializing false. ret: 0x%08x\n", settings_path, res);
-                u8 false_data[] = {'0', '\n'};
-                Write_File(settings_path, false_data, sizeof(false_data));
-            } else if (buffer2[0] == '1' && !strcmp(game_elf, AppElfData)) {
-                s32 ret_cmp = strncmp(game_ver, AppVerData, 5);
-                if (!ret_cmp)
+/*
+ * @brief Resolve and write the enabled entries of one phase
+ *
+ * Lines are written in file order within the phase.
+ * Entries name their module with the Module attribute, the main executable
+ * if it is empty. Signatures are only searched in their module. Entries of
+ * modules that are not loaded yet are deferred until the module loads.
+ *
+ * @param module_hash PHASE_MODULE: name hash of the module that was loaded
+ */
+static void apply_patches(patch_session_t *session, patch_phase_t phase, u64 module_hash)
+{
+    const ghp_t *ghp = &session->ghp;
+    u32 patch_lines = 0;
+    // Gather every enabled line first so all signatures of a module can be resolved in one pass.
+    patch_list_t patches = {};
+    sig_table_t *sigs = (sig_table_t *)calloc(g_modules.size + 1, sizeof(sig_table_t));
+    for (u32 i = 0; i < ghp->header->entry_count; i++) {
+        const ghp_entry_t *entry = &ghp->entry[i];
+        bool early = (entry->flags & GHP_ENTRY_EARLY) != 0;
+        const char *module_name = ghp_string(ghp, entry->module);
+        if (phase == PHASE_MODULE)
+        {
+            if (session->state[i] != ENTRY_DEFERRED || djb2_hash(module_name) != module_hash)
+            {
+                continue;
+            }
+        }
+        else if (session->state[i] != ENTRY_PENDING ||
+                 (phase == PHASE_EARLY && !early) ||
+                 (phase == PHASE_LATE && early))
+        {
+            continue;
+        }
+        module_entry_t *module = module_map_find(&g_modules, module_name);
+        if (!module)
+        {
+            final_printf("Module %s is not loaded, deferring %s\n", module_name, ghp_string(ghp, entry->name));
+            session->state[i] = ENTRY_DEFERRED;
+            deferred_add(&session->deferred, djb2_hash(module_name));
+            continue;
+        }
+        // latched before the module is first written, its fingerprint describes the unpatched code
+        module_crc32c(module);
+        // so is the cave pool, fills written by an earlier phase would look like padding
+        if (session->cave_lines)
+        {
+            module_cave_pool(module);
+        }
+        session->state[i] = ENTRY_APPLIED;
+        const u32 module_index = module - g_modules.module;
+        const bool PRX_patch = module_index != 0;
+        session->patch_items++;
+        for (u32 j = 0; j < entry->line_count; j++)
+        {
+            const ghp_line_t *src = &ghp->line[entry->first_line + j];
+            patch_line_t *line = patch_list_add(&patches);
+            line->src = src;
+            line->module = module_index;
+            line->entry = i;
+            line->owner = ghp_string(ghp, entry->name);
+            if (src->flags & GHP_LINE_MASK)
+            {
+                if (src->target_str)
                 {
-                    debug_printf("App ver %s == %s\n", game_ver, AppVerData);
+                    line->target_sig = sig_table_add(&sigs[module_index], ghp_string(ghp, src->target_str));
                 }
-                else if (!strncmp("mask", AppVerData, 4) || !strncmp("all", AppVerData, 3))
+                line->addr_sig = sig_table_add(&sigs[module_index], ghp_string(ghp, src->addr_str));
+                if (line->addr_sig < 0 || (src->target_str && line->target_sig < 0))
                 {
-                    debug_printf("App ver masked: %s\n", AppVerData);
+                    final_printf("Out of memory for signature %s\n", ghp_string(ghp, src->addr_str));
+                    patches.size--;
                 }
-                else if (ret_cmp)
+                continue;
+            }
+            debug_printf("Address: 0x%lx\n", src->addr);
+            if (!src->addr)
+            {
+                continue;
+            }
+            if (!PRX_patch)
+            {
+                // previous self, eboot patches were made with no aslr addresses
+                line->addr = module->base + (src->addr - NO_ASLR_ADDR);
+            }
+            else
+            {
+                line->addr = module->base + src->addr;
+            }
+        }
+    }
+
+    for (u32 i = 0; i < g_modules.size; i++)
+    {
+        if (sigs[i].size)
+        {
+            resolve_module_signatures(session, &g_modules.module[i], &sigs[i]);
+        }
+    }
+
+    // Addresses first, every range the phase writes leaves the cave pools before a cave is handed out
+    for (u32 i = 0; i < patches.size; i++)
+    {
+        patch_line_t *line = &patches.line[i];
+        const ghp_line_t *src = line->src;
+        const sig_table_t *line_sigs = &sigs[line->module];
+        if (line->target_sig >= 0)
+        {
+            line->jump_addr = line_sigs->entry[line->target_sig].result;
+            debug_printf("Target: 0x%lx jump size %u\n", line->jump_addr, src->jump_size);
+            if (!line->jump_addr)
+            {
+                final_printf("Jump Target: %s not found\n", ghp_string(ghp, src->target_str));
+                line->addr = 0;
+                continue;
+            }
+        }
+        if (line->addr_sig >= 0)
+        {
+            line->addr = line_sigs->entry[line->addr_sig].result;
+            if (!line->addr)
+            {
+                final_printf("Masked Address: %s not found\n", ghp_string(ghp, src->addr_str));
+                continue;
+            }
+            final_printf("Masked Address: 0x%lx\n", line->addr);
+            line->addr += src->offset;
+            debug_printf("after offset: 0x%lx\n", line->addr);
+        }
+        if (!line->addr)
+        {
+            continue;
+        }
+        cave_pool_t *caves = &g_modules.module[line->module].caves;
+        const bool jump = src->type_hash == djb2_hash("mask_jump32") && src->jump_size >= 5;
+        if (jump && line->jump_addr && !cave_claim(caves, line->jump_addr, src->payload_size + 5))
+        {
+            final_printf("Jump Target: %s is used by another patch\n", ghp_string(ghp, src->target_str));
+            line->addr = 0;
+            continue;
+        }
+        cave_reserve(caves, line->addr, jump ? src->jump_size : src->payload_size);
+    }
+
+    write_batch_t batch = {};
+    batch.mode = session->write_mode;
+    batch.undo = session->live ? &session->undo : nullptr;
+    for (u32 i = 0; i < patches.size; i++)
+    {
+        patch_line_t *line = &patches.line[i];
+        const ghp_line_t *src = line->src;
+        if (!line->addr) // address must be present
+        {
+            continue;
+        }
+        if (src->type_hash == djb2_hash("mask_jump32") && src->jump_size >= 5)
+        {
+            // payload and return jump, the segments are only scanned for patches without a Target
+            module_entry_t *module = &g_modules.module[line->module];
+            const u32 cave_size = src->payload_size + 5;
+            if (!line->jump_addr)
+            {
+                line->jump_addr = cave_alloc(module_cave_pool(module), line->addr, cave_size);
+                if (!line->jump_addr)
                 {
-                    debug_printf("App ver %s != %s\n", game_ver, AppVerData);
-                    debug_printf("Skipping patch entry\n");
+                    final_printf("No code cave of %u bytes in range of 0x%lx\n", cave_size, line->addr);
                     continue;
                 }
-                patch_items++;
-                mxml_node_t *Patchlist_node = mxmlFindElement(node, node, "PatchList", NULL, NULL, MXML_DESCEND);
-                for (mxml_node_t *Line_node = mxmlFindElement(node, node, "Line", NULL, NULL, MXML_DESCEND); Line_node != NULL;
-                                  Line_node = mxmlFindElement(Line_node, Patchlist_node, "Line", NULL, NULL, MXML_DESCEND))
+            }
+            if (session->live)
+            {
+                if ((session->cave_count % 16) == 0)
                 {
-                    u64 addr_real = 0;
-                    u64 jump_addr = 0;
-                    u32 jump_size = 0;
-                    bool use_mask = false;
-                    const char *gameType = GetXMLAttr(Line_node, "Type");
-                    const char *gameAddr = GetXMLAttr(Line_node, "Address");
-                    const char *gameValue = GetXMLAttr(Line_node, "Value");
-                    const char *gameOffset = nullptr;
-                    // starts with `mask`
-                    // mask or mask_jump32
-                    if (!strncmp("mask", gameType, 4))
-                    {
-                        use_mask = true;
-                    }
-                    if (use_mask)
-                    {
-                        if (!strcmp("mask_jump32", gameType))
-                        {
-                            const char* gameJumpTarget = GetXMLAttr(Line_node, "Target");
-                            const char* gameJumpSize = GetXMLAttr(Line_node, "Size");
-                            jump_addr = addr_real = (uint64_t)PatternScan(module_base, module_size, gameJumpTarget);
-                            jump_size = strtoul(gameJumpSize, NULL, 10);
-                            debug_printf("Target: 0x%lx jump size %u\n", jump_addr, jump_size);
-                        }
-                        gameOffset = GetXMLAttr(Line_node, "Offset");
-                        addr_real = (uint64_t)PatternScan(module_base, module_size, gameAddr);
-                        if (!addr_real)
-                        {
-                            final_printf("Masked Address: %s not found\n", gameAddr);
-                            continue;
-                        }
-                        final_printf("Masked Address: 0x%lx\n", addr_real);
-                        debug_printf("Offset: %s\n", gameOffset);
-                        u32 real_offset = 0;
-                        if (gameOffset[0] != '0')
-                        {
-                            if (gameOffset[0] == '-')
-                            {
-                                debug_printf("Offset mode: subtract\n");
-                                real_offset = strtoul(gameOffset + 1, NULL, 10);
-                                debug_printf("before offset: 0x%lx\n", addr_real);
-                                addr_real = addr_real - real_offset;
-                                debug_printf("after offset: 0x%lx\n", addr_real);
-                            }
-                            else if (gameOffset[0] == '+')
-                            {
-                                debug_printf("Offset mode: addition\n");
-                                real_offset = strtoul(gameOffset + 1, NULL, 10);
-                                debug_printf("before offset: 0x%lx\n", addr_real);
-                                addr_real = addr_real + real_offset;
-                                debug_printf("after offset: 0x%lx\n", addr_real);
-                            }
-                        }
-                        else
-                        {
-                            debug_printf("Mask does not reqiure offsetting.\n");
-                        }
-                    }
-                    debug_printf("Type: \"%s\"\n", gameType);
-                    if (gameAddr && !use_mask)
-                    {
-                        addr_real = strtoull(gameAddr, NULL, 16);
-                        debug_printf("Address: 0x%lx\n", addr_real);
-                    }
-                    debug_printf("Value: \"%s\"\n", gameValue);
-                    debug_printf("patch line: %u\n", patch_lines);
-                    if (gameType && addr_real) // type and address must be present
-                    {
-                        if (!PRX_patch && !use_mask)
-                        {
-                            // previous self, eboot patches were made with no aslr addresses
-                            addr_real = module_base + (addr_real - NO_ASLR_ADDR);
-                        }
-                        else if (PRX_patch && !use_mask)
-                        {
-                            addr_real = module_base + addr_real;
-                        }
-                        patch_data1(gameType, addr_real, gameValue, jump_size, jump_addr);
-                        patch_lines++;
-                    }
+                    session->caves = (live_cave_t *)realloc(session->caves, (16 + session->cave_count) * sizeof(live_cave_t));
                 }
+                live_cave_t *cave = &session->caves[session->cave_count++];
+                cave->addr = line->jump_addr;
+                cave->module = line->module;
+                cave->entry = line->entry;
             }
         }
+        debug_printf("patch line: %u\n", patch_lines);
+        batch.owner = line->owner;
+        batch.tag = line->entry;
+        patch_data1(&batch, src->type_hash, line->addr, ghp->payload + src->payload, src->payload_size, src->jump_size, line->jump_addr);
+        patch_lines++;
+    }
 
-        mxmlDelete(node);
-        mxmlDelete(tree);
-        free(buffer);
+    u64 start = profile_now();
+    g_profile.writes_queued += batch.size;
+    g_profile.writes_issued += write_batch_flush(&batch);
+    g_profile.write_conflicts += batch.conflicts;
+    profile_add(PROF_WRITE, start);
+
+    free(patches.line);
+    for (u32 i = 0; i < g_modules.size; i++)
+    {
+        sig_table_free(&sigs[i]);
+    }
+    free(sigs);
+    session->patch_lines += patch_lines;
+}
 
-        if (patch_items > 0 && patch_lines > 0)
+static void notify_applied(const patch_session_t *session)
+{
+    if (session->patch_items > 0 && session->patch_lines > 0)
+    {
+        char msg[192];
+        s32 len = snprintf(msg, sizeof(msg), "%u %s Applied\n"
+                                             "%u %s Applied",
+                                             session->patch_items, (session->patch_items == 1) ? "Patch" : "Patches",
+                                             session->patch_lines, (session->patch_lines == 1) ? "Patch Line" : "Patch Lines");
+        if (session->profile_notify)
         {
-            char msg[128];
-            snprintf(msg, sizeof(msg), "%u %s Applied\n"
-                                       "%u %s Applied",
-                                       patch_items, (patch_items == 1) ? "Patch" : "Patches",
-                                       patch_lines, (patch_lines == 1) ? "Patch Line" : "Patch Lines");
-            NotifyStatic(TEX_ICON_SYSTEM, msg);
+            snprintf(msg + len, sizeof(msg) - len, "\nBoot %lu ms, Total %lu ms",
+                     g_profile.boot_us / 1000, g_profile.total_us / 1000);
         }
+        NotifyStatic(TEX_ICON_SYSTEM, msg);
     }
-    else // if (!buffer)
+}
+
+static void run_phase(patch_session_t *session, patch_phase_t phase)
+{
+    u64 start = profile_now();
+    apply_patches(session, phase, 0);
+    final_printf("Phase %s: %lu us\n", phase_name(phase), profile_now() - start);
+}
+
+// Value search commands share the control file, they are handled by search_apply_commands()
+static bool search_command(const char *command)
+{
+    return !strcmp(command, "search") || !strcmp(command, "next") || !strcmp(command, "clear");
+}
+
+/*
+ * @brief Apply the commands of the control file
+ *
+ * `enable <hash>` and `disable <hash>` switch the entry whose settings file
+ * is named after `hash`. Disabled entries get the bytes they replaced
+ * written back, all of them in one batch. Enabled entries are then applied
+ * together like at boot.
+ */
+static void live_apply_commands(patch_session_t *session, char *text)
+{
+    const ghp_t *ghp = &session->ghp;
+    write_batch_t batch = {};
+    batch.mode = session->write_mode;
+    u32 enabled = 0;
+    u32 disabled = 0;
+    char *cursor = text;
+    char *line = nullptr;
+    while ((line = control_next_line(&cursor)))
     {
-        char msg[128];
-        snprintf(msg, sizeof(msg), "File %s\nis empty", input_file);
-        NotifyStatic(TEX_ICON_SYSTEM, msg);
+        char command[16] = {0};
+        char hash_str[32] = {0};
+        if (sscanf(line, "%15s %31s", command, hash_str) < 1 || search_command(command))
+        {
+            continue;
+        }
+        if (strcmp(command, "enable") && strcmp(command, "disable"))
+        {
+            final_printf("Control: unknown command \"%s\"\n", line);
+            continue;
+        }
+        const bool enable = !strcmp(command, "enable");
+        const u64 hash = strtoull(hash_str, NULL, 16);
+        s32 index = -1;
+        for (u32 i = 0; i < ghp->header->entry_count; i++)
+        {
+            if (session->state[i] != ENTRY_OFF && ghp->entry[i].settings_hash == hash)
+            {
+                index = i;
+                break;
+            }
+        }
+        if (index < 0)
+        {
+            final_printf("Control: no patch 0x%016lx for %s\n", hash, game_elf);
+            continue;
+        }
+        u8 *state = &session->state[index];
+        const char *name = ghp_string(ghp, ghp->entry[index].name);
+        if (enable && *state == ENTRY_DISABLED)
+        {
+            final_printf("Control: enable %s\n", name);
+            *state = ENTRY_PENDING;
+            enabled++;
+        }
+        else if (!enable && *state != ENTRY_DISABLED)
+        {
+            u32 newer = 0;
+            if (*state == ENTRY_APPLIED && undo_log_overlapped(&session->undo, index, &newer))
+            {
+                final_printf("Control: can't disable %s, \"%s\" was written over it, disable that first\n",
+                             name, ghp_string(ghp, ghp->entry[newer].name));
+                continue;
+            }
+            // deferred entries have written nothing yet, they only leave the deferred index so enabling them again counts them once
+            if (*state == ENTRY_DEFERRED)
+            {
+                deferred_release(&session->deferred, djb2_hash(ghp_string(ghp, ghp->entry[index].module)));
+            }
+            u32 restored = (*state == ENTRY_APPLIED) ? undo_log_restore(&session->undo, &batch, index) : 0;
+            for (u32 i = session->cave_count; i-- > 0;)
+            {
+                if (session->caves[i].entry == (u32)index)
+                {
+                    cave_release(&g_modules.module[session->caves[i].module].caves, session->caves[i].addr);
+                    session->caves[i] = session->caves[--session->cave_count];
+                }
+            }
+            final_printf("Control: disable %s, %u writes restored\n", name, restored);
+            *state = ENTRY_DISABLED;
+            disabled++;
+        }
     }
-    if (buffer2)
+    u64 start = profile_now();
+    if (batch.size)
     {
-        free(buffer2);
+        write_batch_flush(&batch);
+    }
+    if (enabled)
+    {
+        apply_patches(session, PHASE_ALL, 0);
+    }
+    if (enabled || disabled)
+    {
+        final_printf("Control: %u enabled, %u disabled in %lu us\n", enabled, disabled, profile_now() - start);
+        Notify(TEX_ICON_SYSTEM, "%u %s Enabled\n%u %s Disabled",
+               enabled, (enabled == 1) ? "Patch" : "Patches",
+               disabled, (disabled == 1) ? "Patch" : "Patches");
     }
 }
 
-void mkdir_chmod(const char *path, OrbisKernelMode mode)
+static bool search_parse_filter(search_type_t type, const char *cmp, const char *a, const char *b, search_filter_t *filter)
 {
-    sceKernelMkdir(path, mode);
-    sceKernelChmod(path, mode);
+    static const char *names[] = {"any", "eq", "range", "changed", "unchanged", "increased", "decreased"};
+    memset(filter, 0, sizeof(*filter));
+    for (u32 i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        if (!strcmp(cmp, names[i]))
+        {
+            filter->cmp = (search_cmp_t)i;
+            if (filter->cmp == SEARCH_EQ)
+            {
+                return search_parse_value(type, a, &filter->a);
+            }
+            if (filter->cmp == SEARCH_RANGE)
+            {
+                return search_parse_value(type, a, &filter->a) && search_parse_value(type, b, &filter->b);
+            }
+            return true;
+        }
+    }
+    return false;
 }
 
-void make_folders(void)
+// list the first candidates with their current values
+static void search_write_results(const search_t *search)
 {
-    mkdir_chmod(GOLDHEN_PATH_, 0777);
-    mkdir_chmod(BASE_PATH_PATCH, 0777);
-    mkdir_chmod(BASE_PATH_PATCH_XML, 0777);
-    mkdir_chmod(BASE_PATH_PATCH_SETTINGS, 0777);
+    u64 addr[SEARCH_RESULTS_MAX];
+    u32 count = search_results(search, addr, SEARCH_RESULTS_MAX);
+    byte_buffer_t out = {};
+    char line[128];
+    s32 len = snprintf(line, sizeof(line), "# pass %u, %lu candidates\n", search->passes, search->count);
+    buffer_append(&out, line, len);
+    for (u32 i = 0; i < count; i++)
+    {
+        char value[48];
+        search_format_value(search->type, search_read_value(search->type, addr[i]), value, sizeof(value));
+        len = snprintf(line, sizeof(line), "0x%016lx %s\n", addr[i], value);
+        buffer_append(&out, line, len);
+    }
+    Write_File(BASE_PATH_PATCH_SEARCH, out.data, out.size);
+    buffer_free(&out);
+}
+
+/*
+ * @brief Run the value search commands of the control file
+ *
+ * `search <type> <any|eq|range> [a] [b]` scans the writable memory of the
+ * process for values of type u8, u16, u32, u64, f32 or f64.
+ * `next <eq|range|changed|unchanged|increased|decreased> [a] [b]` narrows
+ * the candidates, `clear` drops them. After each pass the first candidates
+ * are written to BASE_PATH_PATCH_SEARCH.
+ */
+static void search_apply_commands(char *text)
+{
+    char *cursor = text;
+    char *line = nullptr;
+    while ((line = control_next_line(&cursor)))
+    {
+        char command[16] = {0};
+        char arg[4][64] = {};
+        s32 args = sscanf(line, "%15s %63s %63s %63s %63s", command, arg[0], arg[1], arg[2], arg[3]) - 1;
+        if (args < 0 || !search_command(command))
+        {
+            continue;
+        }
+        if (!strcmp(command, "clear"))
+        {
+            search_free(&g_search);
+            final_printf("Search: cleared\n");
+            continue;
+        }
+        const bool first = !strcmp(command, "search");
+        search_type_t type = g_search.type;
+        search_filter_t filter;
+        if ((first && (args < 2 || !search_parse_type(arg[0], &type))) ||
+            (!first && (args < 1 || !g_search.passes)) ||
+            !search_parse_filter(type, first ? arg[1] : arg[0], first ? arg[2] : arg[1], first ? arg[3] : arg[2], &filter) ||
+            (first && filter.cmp > SEARCH_RANGE))
+        {
+            final_printf("Search: invalid command \"%s\"\n", line);
+            continue;
+        }
+        u64 start = profile_now();
+        if (first)
+        {
+            search_free(&g_search);
+            search_begin(&g_search, type);
+            search_first_process(&g_search, &filter);
+        }
+        else
+        {
+            search_next(&g_search, &filter);
+        }
+        final_printf("Search: pass %u, %lu candidates, %lu bytes held, %lu us\n",
+                     g_search.passes, g_search.count, g_search.memory, profile_now() - start);
+        search_write_results(&g_search);
+        Notify(TEX_ICON_SYSTEM, "Search pass %u\n%lu %s", g_search.passes, g_search.count,
+               (g_search.count == 1) ? "Candidate" : "Candidates");
+    }
 }
 
-// https://github.com/bucanero/apollo-ps4/blob/a530cae3c81639eedebac606c67322acd6fa8965/source/orbis_jbc.c#L62
-int get_module_info(OrbisKernelModuleInfo moduleInfo, const char* name, uint64_t *base, uint32_t *size)
+/*
+ * @brief Add the queued modules to the map and apply their deferred entries
+ *
+ * Called with g_patch_mutex held. The queue is taken in one go so the load
+ * hook can keep adding to it meanwhile.
+ */
+static void apply_loaded_modules(void)
 {
-    OrbisKernelModule handles[256];
-    size_t numModules;
-    int ret = 0;
-    ret = sceKernelGetModuleList(handles, sizeof(handles), &numModules);
-    if (ret)
+    scePthreadMutexLock(&g_loaded_mutex);
+    loaded_queue_t loaded = g_loaded;
+    g_loaded = {};
+    scePthreadMutexUnlock(&g_loaded_mutex);
+    for (u32 i = 0; i < loaded.size; i++)
     {
-        final_printf("sceKernelGetModuleList (0x%08x)\n", ret);
-        return ret;
+        // recorded with or without a session, so the map never misses a module whatever runs next
+        const module_entry_t *module = module_map_add(&g_modules, loaded.handle[i]);
+        if (!g_session_live || !module || deferred_find(&g_session.deferred, module->name_hash) < 0)
+        {
+            continue;
+        }
+        u64 name_hash = module->name_hash;
+        char name[sizeof(module->name)];
+        strcpy(name, module->name);
+        u32 patch_items = g_session.patch_items;
+        u64 start = profile_now();
+        apply_patches(&g_session, PHASE_MODULE, name_hash);
+        deferred_remove(&g_session.deferred, name_hash);
+        final_printf("Phase %s %s: %lu us\n", phase_name(PHASE_MODULE), name, profile_now() - start);
+        patch_items = g_session.patch_items - patch_items;
+        if (patch_items)
+        {
+            Notify(TEX_ICON_SYSTEM, "%u %s Applied to %s", patch_items, (patch_items == 1) ? "Patch" : "Patches", name);
+        }
+        if (!g_session.deferred.size && !g_late_pending && !g_session.live)
+        {
+            g_session_live = false;
+            patch_session_free(&g_session);
+        }
     }
-    final_printf("numModules: %li\n", numModules);
-    for (size_t i = 0; i < numModules; ++i)
+    free(loaded.handle);
+}
+
+/*
+ * @brief Release g_patch_mutex, after applying the modules queued while it was held
+ *
+ * A module queued after the last check finds the mutex free, or held by
+ * someone who checks again before releasing it.
+ */
+static void patch_mutex_unlock(void)
+{
+    for (;;)
     {
-        ret = sceKernelGetModuleInfo(handles[i], &moduleInfo);
-        final_printf("ret 0x%x\n", ret);
-        final_printf("module %li\n", i);
-        final_printf("name: %s\n", moduleInfo.name);
-        final_printf("start: 0x%lx\n", (uint64_t)moduleInfo.segmentInfo[0].address);
-        final_printf("size: %u (0x%x)\n", moduleInfo.segmentInfo[0].size, moduleInfo.segmentInfo[0].size);
-        if (ret)
+        apply_loaded_modules();
+        scePthreadMutexUnlock(&g_patch_mutex);
+        scePthreadMutexLock(&g_loaded_mutex);
+        const bool queued = g_loaded.size != 0;
+        scePthreadMutexUnlock(&g_loaded_mutex);
+        if (!queued || scePthreadMutexTrylock(&g_patch_mutex))
         {
-            final_printf("sceKernelGetModuleInfo (%X)\n", ret);
-            return ret;
+            return;
         }
+    }
+}
 
-        if (strcmp(moduleInfo.name, name) == 0 || name[0] == '0')
+/*
+ * @brief Poll the control file until module_stop()
+ *
+ * Commands already in the file when the game starts are ignored, the file
+ * has to change to be read. Searches run without holding g_patch_mutex.
+ */
+void *control_thread(void *args)
+{
+    const u32 poll_us = g_control_poll_ms * 1000;
+    control_file_t control;
+    control_init(&control, BASE_PATH_PATCH_CONTROL);
+    while (!g_control_stop)
+    {
+        sceKernelUsleep(poll_us);
+        char *text = control_poll(&control);
+        if (!text)
+        {
+            continue;
+        }
+        if (g_value_search)
+        {
+            // lines are split in place, each handler gets its own copy
+            char *copy = strdup(text);
+            search_apply_commands(copy);
+            free(copy);
+        }
+        scePthreadMutexLock(&g_patch_mutex);
+        if (g_session_live && g_session.live)
         {
-            if (base)
-                *base = (uint64_t)moduleInfo.segmentInfo[0].address;
+            live_apply_commands(&g_session, text);
+        }
+        patch_mutex_unlock();
+        free(text);
+    }
+    return NULL;
+}
+
+static void patch_session_finish(patch_session_t *session)
+{
+    g_profile.total_us = profile_now() - g_profile.start;
+    profile_print(&g_profile);
+    notify_applied(session);
+    if (session->profile_log)
+    {
+        profile_write(&g_profile, PROFILE_LOG_PATH, titleid, game_elf, game_ver);
+    }
+    if (session->live)
+    {
+        // the session is kept for the rest of the game, control_thread() applies the toggles
+        final_printf("Live patches: session kept for %s\n", BASE_PATH_PATCH_CONTROL);
+        return;
+    }
+    if (session->deferred.size)
+    {
+        // kept for sceKernelLoadStartModule_hook()
+        final_printf("%u modules with deferred patches\n", session->deferred.size);
+        return;
+    }
+    g_session_live = false;
+    patch_session_free(session);
+}
 
-            if (size)
-                *size = moduleInfo.segmentInfo[0].size;
-            return 1;
+/*
+ * @brief Apply the deferred entries of modules loaded after module_start()
+ *
+ * Every loaded module is queued for the module map, once every entry has
+ * been applied that is all it does. The queue is only locked for the
+ * handoff: while a phase holds g_patch_mutex, the module is applied by
+ * that thread when it releases it, and the game's loader doesn't wait.
+ */
+s32 sceKernelLoadStartModule_hook(const char *path, size_t argc, const void *argv, u32 flags, void *opt, s32 *res)
+{
+    s32 handle = HOOK_CONTINUE(sceKernelLoadStartModule,
+                               s32 (*)(const char *, size_t, const void *, u32, void *, s32 *),
+                               path, argc, argv, flags, opt, res);
+    if (handle < 0)
+    {
+        return handle;
+    }
+    scePthreadMutexLock(&g_loaded_mutex);
+    if ((g_loaded.size % 16) == 0)
+    {
+        g_loaded.handle = (s32 *)realloc(g_loaded.handle, (16 + g_loaded.size) * sizeof(s32));
+    }
+    g_loaded.handle[g_loaded.size++] = handle;
+    scePthreadMutexUnlock(&g_loaded_mutex);
+    if (!scePthreadMutexTrylock(&g_patch_mutex))
+    {
+        patch_mutex_unlock();
+    }
+    return handle;
+}
+
+void *patch_thread(void *args)
+{
+    scePthreadMutexLock(&g_patch_mutex);
+    run_phase(&g_session, PHASE_LATE);
+    patch_session_finish(&g_session);
+    g_late_pending = false;
+    patch_mutex_unlock();
+    final_printf("Late patches done\n");
+    scePthreadExit(NULL);
+    return NULL;
+}
+
+/*
+ * @brief Apply the patches of the running title
+ *
+ * With the `async_patches` option only entries marked Early are applied
+ * here, the rest are applied by a worker thread once this returns.
+ * Early entries are always written before late ones, each phase writes
+ * its lines in file order. Entries of modules that are not loaded yet are
+ * applied by sceKernelLoadStartModule_hook() when the module loads.
+ * With the `live_patches` option the session is kept and entries can be
+ * switched on and off through the control file, see live_apply_commands().
+ */
+void get_key_init(void)
+{
+    scePthreadMutexLock(&g_patch_mutex);
+    // modules loaded from here on are queued by the load hook and mapped when this releases the mutex
+    g_session_live = true;
+    u64 start = profile_now();
+    u32 enabled = patch_session_init(&g_session);
+    final_printf("Phase load: %lu us, %u entries enabled\n", profile_now() - start, enabled);
+    if (!enabled && g_session.live && g_session.matched)
+    {
+        // nothing to write yet, entries can still be enabled through the control file
+        g_profile.boot_us = profile_now() - g_profile.start;
+        patch_session_finish(&g_session);
+        patch_mutex_unlock();
+        return;
+    }
+    if (!enabled)
+    {
+        g_session_live = false;
+        patch_session_free(&g_session);
+        patch_mutex_unlock();
+        return;
+    }
+    if (option_enabled("async_patches"))
+    {
+        run_phase(&g_session, PHASE_EARLY);
+        // set before the worker starts, it reports the profile when done
+        g_profile.boot_us = profile_now() - g_profile.start;
+        g_late_pending = true;
+        s32 ret = scePthreadCreate(&g_patch_thread, NULL, patch_thread, NULL, "game_patch_late");
+        if (ret == 0)
+        {
+            final_printf("Boot blocked for %lu us, late patches continue in background\n", g_profile.boot_us);
+            patch_mutex_unlock();
+            return;
         }
+        final_printf("scePthreadCreate 0x%08x, applying late patches now\n", ret);
+        g_patch_thread = nullptr;
+        g_late_pending = false;
+        run_phase(&g_session, PHASE_LATE);
     }
-    return 0;
+    else
+    {
+        run_phase(&g_session, PHASE_ALL);
+    }
+    g_profile.boot_us = profile_now() - g_profile.start;
+    patch_session_finish(&g_session);
+    patch_mutex_unlock();
+}
+
+void mkdir_chmod(const char *path, OrbisKernelMode mode)
+{
+    sceKernelMkdir(path, mode);
+    sceKernelChmod(path, mode);
+}
+
+void make_folders(void)
+{
+    mkdir_chmod(GOLDHEN_PATH_, 0777);
+    mkdir_chmod(BASE_PATH_PATCH, 0777);
+    mkdir_chmod(BASE_PATH_PATCH_XML, 0777);
+    mkdir_chmod(BASE_PATH_PATCH_SETTINGS, 0777);
+    mkdir_chmod(BASE_PATH_PATCH_CACHE, 0777);
+    mkdir_chmod(BASE_PATH_PATCH_OPTIONS, 0777);
 }
 
 extern "C" {
@@ -354,13 +1190,19 @@ s32 attr_module_hidden module_start(s64 argc, const void *args) {
     final_printf("[GoldHEN] Plugin Author(s): %s\n", g_pluginAuth);
     boot_ver();
     struct proc_info procInfo;
-    OrbisKernelModuleInfo CurrentModuleInfo;
-    CurrentModuleInfo.size = sizeof(OrbisKernelModuleInfo);
-    if(!get_module_info(CurrentModuleInfo, "0", &module_base, &module_size) && module_base && module_size)
+    if (!module_map_load(&g_modules) || !g_modules.module[0].base || !g_modules.module[0].size)
     {
         final_printf("Could not find module info for current process\n");
+        module_map_free(&g_modules);
         return -1;
     }
+    module_base = g_modules.module[0].base;
+    module_size = g_modules.module[0].size;
+    // AppFingerprint and the signature caches need the CRC of the unpatched executable, the profile starts before it
+    memset(&g_profile, 0, sizeof(g_profile));
+    g_profile.start = profile_now();
+    module_crc32c(&g_modules.module[0]);
+    profile_add(PROF_SCAN, g_profile.start);
     final_printf("Module start: 0x%lx 0x%x\n", module_base, module_size);
     if (sys_sdk_proc_info(&procInfo) == 0) {
         memcpy(titleid, procInfo.titleid, sizeof(titleid));
@@ -368,7 +1210,18 @@ s32 attr_module_hidden module_start(s64 argc, const void *args) {
         memcpy(game_ver, procInfo.version, sizeof(game_ver));
         make_folders();
         print_proc_info();
+        scePthreadMutexInit(&g_patch_mutex, NULL, "game_patch");
+        scePthreadMutexInit(&g_loaded_mutex, NULL, "game_patch_loaded");
+        HOOK32(sceKernelLoadStartModule);
         get_key_init();
+        g_value_search = option_enabled("value_search");
+        if (g_value_search || option_enabled("live_patches"))
+        {
+            g_control_poll_ms = option_u32("live_poll_ms", 500);
+            g_search.memory_limit = (u64)option_u32("search_memory_mb", 256) << 20;
+            g_control_started = thread_start(&g_control_thread, control_thread, NULL, "game_patch_control");
+            final_printf("Control: polling %s every %u ms\n", BASE_PATH_PATCH_CONTROL, g_control_poll_ms);
+        }
         return 0;
     }
     NotifyStatic(TEX_ICON_SYSTEM, "Unable to get process info from " STRINGIFY(sys_sdk_proc_info));
@@ -379,6 +1232,40 @@ s32 attr_module_hidden module_start(s64 argc, const void *args) {
 extern "C" {
 s32 attr_module_hidden module_stop(s64 argc, const void *args) {
     final_printf("[GoldHEN] <%s\\Ver.0x%08x> %s\n", g_pluginName, g_pluginVersion, __func__);
+    if (g_patch_mutex)
+    {
+        UNHOOK(sceKernelLoadStartModule);
+    }
+    if (g_patch_thread)
+    {
+        // don't unload while late patches are being written
+        scePthreadJoin(g_patch_thread, NULL);
+        g_patch_thread = nullptr;
+    }
+    if (g_control_started)
+    {
+        g_control_stop = true;
+        thread_join(g_control_thread);
+        g_control_started = false;
+    }
+    search_free(&g_search);
+    if (g_patch_mutex)
+    {
+        scePthreadMutexLock(&g_patch_mutex);
+        if (g_session_live)
+        {
+            g_session_live = false;
+            patch_session_free(&g_session);
+        }
+        free(g_loaded.handle);
+        g_loaded = {};
+        scePthreadMutexUnlock(&g_patch_mutex);
+        scePthreadMutexDestroy(&g_patch_mutex);
+        scePthreadMutexDestroy(&g_loaded_mutex);
+        g_patch_mutex = nullptr;
+        g_loaded_mutex = nullptr;
+    }
+    module_map_free(&g_modules);
     return 0;
 }
 }
@@ -0,0 +1,295 @@
+#include "memory.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/uio.h>
+#else
+#include "patch.h"
+#endif
+
+/*
+ * @brief Get the mapping containing `addr` and its protection
+ */
+bool mem_query_protection(u64 addr, u64 *start, u64 *end, s32 *prot)
+{
+#if defined(__linux__)
+    FILE *maps = fopen("/proc/self/maps", "r");
+    if (!maps)
+    {
+        return false;
+    }
+    char line[512];
+    bool found = false;
+    while (fgets(line, sizeof(line), maps))
+    {
+        unsigned long lo = 0, hi = 0;
+        char perms[5] = {0};
+        if (sscanf(line, "%lx-%lx %4s", &lo, &hi, perms) != 3 || addr < lo || addr >= hi)
+        {
+            continue;
+        }
+        *start = lo;
+        *end = hi;
+        *prot = (perms[0] == 'r' ? MEM_PROT_READ : 0) |
+                (perms[1] == 'w' ? MEM_PROT_WRITE : 0) |
+                (perms[2] == 'x' ? MEM_PROT_EXEC : 0);
+        found = true;
+        break;
+    }
+    fclose(maps);
+    return found;
+#else
+    void *region_start = nullptr;
+    void *region_end = nullptr;
+    u32 region_prot = 0;
+    s32 ret = sceKernelQueryMemoryProtection((void *)addr, &region_start, &region_end, &region_prot);
+    if (ret)
+    {
+        debug_printf("sceKernelQueryMemoryProtection(0x%lx) 0x%08x\n", addr, ret);
+        return false;
+    }
+    *start = (u64)region_start;
+    *end = (u64)region_end;
+    *prot = (s32)(region_prot & (MEM_PROT_READ | MEM_PROT_WRITE | MEM_PROT_EXEC));
+    return true;
+#endif
+}
+
+/*
+ * @brief Get the first mapping that ends after `addr`
+ *
+ * Used to walk the address space, start at 0 and continue from `end`.
+ */
+bool mem_next_region(u64 addr, u64 *start, u64 *end, s32 *prot)
+{
+#if defined(__linux__)
+    FILE *maps = fopen("/proc/self/maps", "r");
+    if (!maps)
+    {
+        return false;
+    }
+    char line[512];
+    bool found = false;
+    while (fgets(line, sizeof(line), maps))
+    {
+        unsigned long lo = 0, hi = 0;
+        char perms[5] = {0};
+        if (sscanf(line, "%lx-%lx %4s", &lo, &hi, perms) != 3 || hi <= addr)
+        {
+            continue;
+        }
+        *start = lo;
+        *end = hi;
+        *prot = (perms[0] == 'r' ? MEM_PROT_READ : 0) |
+                (perms[1] == 'w' ? MEM_PROT_WRITE : 0) |
+                (perms[2] == 'x' ? MEM_PROT_EXEC : 0);
+        found = true;
+        break;
+    }
+    fclose(maps);
+    return found;
+#else
+    OrbisKernelVirtualQueryInfo info;
+    memset(&info, 0, sizeof(info));
+    // 1: SCE_KERNEL_VQ_FIND_NEXT, the next mapping if `addr` is not mapped
+    s32 ret = sceKernelVirtualQuery((const void *)addr, 1, &info, sizeof(info));
+    if (ret)
+    {
+        return false;
+    }
+    *start = (u64)info.start;
+    *end = (u64)info.end;
+    *prot = (s32)(info.protection & (MEM_PROT_READ | MEM_PROT_WRITE | MEM_PROT_EXEC));
+    return true;
+#endif
+}
+
+static constexpr u64 page_size = MEM_PAGE_SIZE;
+
+/*
+ * @brief Copy memory of the current process through the kernel
+ *
+ * A range that is unmapped or not readable, even if that changes while
+ * the copy runs, fails the call instead of faulting the game.
+ */
+bool mem_read(u64 addr, void *data, u64 size)
+{
+#if defined(__linux__)
+    struct iovec local = {data, size};
+    struct iovec remote = {(void *)addr, size};
+    return process_vm_readv(getpid(), &local, 1, &remote, 1, 0) == (ssize_t)size;
+#else
+    return sys_proc_read(addr, data, size);
+#endif
+}
+
+/*
+ * @brief Map zeroed read/write memory of its own, `size` a multiple of MEM_PAGE_SIZE
+ *
+ * @returns nullptr if the mapping failed
+ */
+void *mem_map(u64 size)
+{
+#if defined(__linux__)
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return (data == MAP_FAILED) ? nullptr : data;
+#else
+    void *data = nullptr;
+    // 0x1002: MAP_ANON | MAP_PRIVATE
+    s32 ret = sceKernelMmap(nullptr, size, MEM_PROT_READ | MEM_PROT_WRITE, 0x1002, -1, 0, &data);
+    if (ret)
+    {
+        debug_printf("sceKernelMmap(0x%lx) 0x%08x\n", size, ret);
+        return nullptr;
+    }
+    return data;
+#endif
+}
+
+void mem_unmap(void *data, u64 size)
+{
+#if defined(__linux__)
+    munmap(data, size);
+#else
+    sceKernelMunmap(data, size);
+#endif
+}
+
+bool mem_protect(u64 addr, u64 size, s32 prot)
+{
+#if defined(__linux__)
+    return mprotect((void *)addr, size, prot) == 0;
+#else
+    s32 ret = sceKernelMprotect((void *)addr, size, prot);
+    if (ret)
+    {
+        debug_printf("sceKernelMprotect(0x%lx, 0x%lx, %i) 0x%08x\n", addr, size, prot, ret);
+    }
+    return ret == 0;
+#endif
+}
+
+/*
+ * @brief Write to memory of the current process without a syscall per write
+ *
+ * Pages that are not writable are made writable, written with memcpy and
+ * set back to their original protection. Ranges spanning several mappings
+ * are handled one mapping at a time.
+ *
+ * @returns false if a mapping could not be queried or remapped,
+ *          nothing from that mapping onwards has been written
+ */
+bool mem_write_direct(u64 addr, const void *data, u64 size)
+{
+    const u8 *src = (const u8 *)data;
+    while (size)
+    {
+        u64 start = 0;
+        u64 end = 0;
+        s32 prot = 0;
+        if (!mem_query_protection(addr, &start, &end, &prot))
+        {
+            return false;
+        }
+        u64 chunk = (end - addr < size) ? end - addr : size;
+        if (prot & MEM_PROT_WRITE)
+        {
+            memcpy((void *)addr, src, chunk);
+        }
+        else
+        {
+            u64 page_start = addr & ~(page_size - 1);
+            u64 page_end = (addr + chunk + page_size - 1) & ~(page_size - 1);
+            if (page_start < start)
+            {
+                page_start = start;
+            }
+            if (page_end > end)
+            {
+                page_end = end;
+            }
+            if (!mem_protect(page_start, page_end - page_start, prot | MEM_PROT_READ | MEM_PROT_WRITE))
+            {
+                return false;
+            }
+            memcpy((void *)addr, src, chunk);
+            mem_protect(page_start, page_end - page_start, prot);
+        }
+        addr += chunk;
+        src += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+/*
+ * @brief Write spans sorted by address, one protection change per mapping
+ *
+ * The pages from the first to the last span inside a mapping are made
+ * writable once, instead of querying and remapping for every span. A span
+ * that leaves its mapping is written with mem_write_direct().
+ *
+ * @param offset Offset of each span's bytes in `data`
+ * @param skip   Spans to leave out, nullptr for none
+ * @param done   Set for each span written
+ * @returns      Number of spans written
+ */
+u32 mem_write_direct_spans(const u64 *addr, const u64 *size, const u8 *data, const u64 *offset,
+                           const u8 *skip, u32 count, u8 *done)
+{
+    u32 written = 0;
+    u32 i = 0;
+    while (i < count)
+    {
+        u64 start = 0;
+        u64 end = 0;
+        s32 prot = 0;
+        if ((skip && skip[i]) || !mem_query_protection(addr[i], &start, &end, &prot))
+        {
+            i++;
+            continue;
+        }
+        u32 last = i;
+        while (last < count && addr[last] + size[last] <= end)
+        {
+            last++;
+        }
+        if (last == i)
+        {
+            done[i] = mem_write_direct(addr[i], data + offset[i], size[i]);
+            written += done[i];
+            i++;
+            continue;
+        }
+        u64 page_start = addr[i] & ~(page_size - 1);
+        u64 page_end = (addr[last - 1] + size[last - 1] + page_size - 1) & ~(page_size - 1);
+        if (page_start < start)
+        {
+            page_start = start;
+        }
+        if (page_end > end)
+        {
+            page_end = end;
+        }
+        const bool remap = !(prot & MEM_PROT_WRITE);
+        if (!remap || mem_protect(page_start, page_end - page_start, prot | MEM_PROT_READ | MEM_PROT_WRITE))
+        {
+            for (u32 j = i; j < last; j++)
+            {
+                if (skip && skip[j])
+                {
+                    continue;
+                }
+                memcpy((void *)addr[j], data + offset[j], size[j]);
+                done[j] = 1;
+                written++;
+            }
+            if (remap)
+            {
+                mem_protect(page_start, page_end - page_start, prot);
+            }
+        }
+        i = last;
+    }
+    return written;
+}
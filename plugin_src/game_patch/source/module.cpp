@@ -0,0 +1,232 @@
+#include "module.h"
+#include "crc32c.h"
+#include "patch.h"
+
+static void module_entry_set(module_entry_t *module, const OrbisKernelModuleInfo *info)
+{
+    memset(module, 0, sizeof(*module));
+    strncpy(module->name, info->name, sizeof(module->name) - 1);
+    module->name_hash = djb2_hash(module->name);
+    module->segment_count = info->segmentCount < MODULE_MAX_SEGMENTS ? info->segmentCount : MODULE_MAX_SEGMENTS;
+    for (u32 i = 0; i < module->segment_count; i++)
+    {
+        module->segment[i].addr = (u64)info->segmentInfo[i].address;
+        module->segment[i].size = info->segmentInfo[i].size;
+        module->segment[i].prot = info->segmentInfo[i].prot;
+    }
+    module->base = module->segment[0].addr;
+    module->size = module->segment[0].size;
+}
+
+/*
+ * @brief List the loaded modules
+ *
+ * @param map Output, module[0] is the main executable
+ * @returns   false if the module list could not be read
+ */
+// https://github.com/bucanero/apollo-ps4/blob/a530cae3c81639eedebac606c67322acd6fa8965/source/orbis_jbc.c#L62
+bool module_map_load(module_map_t *map)
+{
+    OrbisKernelModule handles[256];
+    size_t numModules = 0;
+    map->module = nullptr;
+    map->size = 0;
+    s32 ret = sceKernelGetModuleList(handles, sizeof(handles), &numModules);
+    if (ret)
+    {
+        final_printf("sceKernelGetModuleList (0x%08x)\n", ret);
+        return false;
+    }
+    final_printf("numModules: %li\n", numModules);
+    map->module = (module_entry_t *)malloc(numModules * sizeof(module_entry_t));
+    for (size_t i = 0; i < numModules; ++i)
+    {
+        OrbisKernelModuleInfo info;
+        info.size = sizeof(info);
+        ret = sceKernelGetModuleInfo(handles[i], &info);
+        if (ret)
+        {
+            final_printf("sceKernelGetModuleInfo (%X)\n", ret);
+            continue;
+        }
+        module_entry_t *module = &map->module[map->size++];
+        module_entry_set(module, &info);
+        debug_printf("module %li: %s\n", i, module->name);
+        for (u32 j = 0; j < module->segment_count; j++)
+        {
+            debug_printf("segment %u: 0x%lx size 0x%x prot %d\n", j, module->segment[j].addr, module->segment[j].size, module->segment[j].prot);
+        }
+    }
+    return map->size > 0;
+}
+
+/*
+ * @brief Add a module loaded after module_map_load(), a module already in the map is refreshed
+ *
+ * @returns nullptr if the module info could not be read
+ */
+module_entry_t *module_map_add(module_map_t *map, OrbisKernelModule handle)
+{
+    OrbisKernelModuleInfo info;
+    info.size = sizeof(info);
+    s32 ret = sceKernelGetModuleInfo(handle, &info);
+    if (ret)
+    {
+        final_printf("sceKernelGetModuleInfo (%X)\n", ret);
+        return nullptr;
+    }
+    module_entry_t *module = info.name[0] ? module_map_find(map, info.name) : nullptr;
+    if (module)
+    {
+        // reloaded, caves of the old image are gone
+        cave_pool_free(&module->caves);
+    }
+    else
+    {
+        map->module = (module_entry_t *)realloc(map->module, (map->size + 1) * sizeof(module_entry_t));
+        module = &map->module[map->size++];
+    }
+    module_entry_set(module, &info);
+    debug_printf("module %u: %s 0x%lx\n", map->size - 1, module->name, module->base);
+    return module;
+}
+
+/*
+ * @brief Find a module by name
+ *
+ * @param name Module name, empty for the main executable
+ * @returns    nullptr if it is not loaded
+ */
+module_entry_t *module_map_find(const module_map_t *map, const char *name)
+{
+    if (!map->size)
+    {
+        return nullptr;
+    }
+    if (!name[0])
+    {
+        return &map->module[0];
+    }
+    u64 hash = djb2_hash(name);
+    for (u32 i = 0; i < map->size; i++)
+    {
+        if (map->module[i].name_hash == hash && !strcmp(map->module[i].name, name))
+        {
+            return &map->module[i];
+        }
+    }
+    return nullptr;
+}
+
+void module_map_free(module_map_t *map)
+{
+    for (u32 i = 0; i < map->size; i++)
+    {
+        cave_pool_free(&map->module[i].caves);
+    }
+    free(map->module);
+    map->module = nullptr;
+    map->size = 0;
+}
+
+/*
+ * @brief CRC32C of the executable segments of a module, computed once
+ *
+ * Latched before the first patch is written to the module, so later calls
+ * return the CRC of the unpatched code.
+ */
+u32 module_crc32c(module_entry_t *module)
+{
+    if (!module->crc_valid)
+    {
+        u64 start = sceKernelGetProcessTime();
+        u32 crc = 0;
+        u64 size = 0;
+        for (u32 i = 0; i < module->segment_count; i++)
+        {
+            if (module->segment[i].prot & ORBIS_KERNEL_PROT_CPU_EXEC)
+            {
+                crc = crc32c(crc, (const void *)module->segment[i].addr, module->segment[i].size);
+                size += module->segment[i].size;
+            }
+        }
+        if (!size)
+        {
+            crc = crc32c(0, (const void *)module->base, module->size);
+            size = module->size;
+        }
+        module->crc = crc;
+        module->crc_valid = true;
+        final_printf("%s CRC32C: 0x%08x (%lu bytes, %lu us)\n", module->name, crc, size, sceKernelGetProcessTime() - start);
+    }
+    return module->crc;
+}
+
+/*
+ * @brief Code cave pool of a module, its executable segments are scanned on first use
+ *
+ * apply_patches() calls it before the first write to the module, the scan
+ * must not see patched bytes.
+ */
+cave_pool_t *module_cave_pool(module_entry_t *module)
+{
+    if (!module->caves.scanned)
+    {
+        for (u32 i = 0; i < module->segment_count; i++)
+        {
+            if (module->segment[i].prot & ORBIS_KERNEL_PROT_CPU_EXEC)
+            {
+                cave_pool_scan(&module->caves, module->segment[i].addr, module->segment[i].size);
+            }
+        }
+        module->caves.scanned = true;
+    }
+    return &module->caves;
+}
+
+/*
+ * @brief Resolve the pending signatures of `table` in the executable segments of a module
+ *
+ * Segments are searched in order, a signature not found in one segment is
+ * searched in the next.
+ *
+ * @param threads Scan threads per segment, 1 to scan on the calling thread only
+ * @returns       Number of bytes walked
+ */
+u64 module_resolve_signatures(const module_entry_t *module, sig_table_t *table, u32 threads)
+{
+    u8 *pending = (u8 *)malloc(table->size + 1);
+    for (u32 i = 0; i < table->size; i++)
+    {
+        pending[i] = !table->entry[i].resolved;
+    }
+    u64 walked = 0;
+    bool first = true;
+    for (u32 i = 0; i < module->segment_count; i++)
+    {
+        const module_segment_t *segment = &module->segment[i];
+        if (!(segment->prot & ORBIS_KERNEL_PROT_CPU_EXEC) || !segment->size)
+        {
+            continue;
+        }
+        if (!first)
+        {
+            for (u32 j = 0; j < table->size; j++)
+            {
+                if (pending[j] && !table->entry[j].result)
+                {
+                    table->entry[j].resolved = false;
+                }
+            }
+        }
+        walked += sig_table_resolve_parallel(table, segment->addr, segment->size, threads);
+        first = false;
+    }
+    if (first && module->size)
+    {
+        // no segment reported as executable, fall back to segment 0
+        walked += sig_table_resolve_parallel(table, module->base, module->size, threads);
+    }
+    free(pending);
+    return walked;
+}
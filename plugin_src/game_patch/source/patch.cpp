@@ -1,10 +1,5 @@
 #include "patch.h"
 
-u8 arr8[1];
-u8 arr16[2];
-u8 arr32[4];
-u8 arr64[8];
-
 char* unescape(const char *s) {
     s64 len = strlen(s);
     char *unescaped_str = (char *)malloc(len + 1);
@@ -52,53 +47,6 @@ char* unescape(const char *s) {
 }
 
 // valid hex look up table.
-const u8 hex_lut[] = {
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00 };
-
-u8 *hexstrtochar2(const char *hexstr, s64 *size) {
-
-    u32 str_len = strlen(hexstr);
-    s64 data_len = ((str_len + 1) / 2) * sizeof(u8);
-    *size = (str_len) * sizeof(u8);
-    u8 *data = (u8 *)malloc(*size);
-    u32 j = 0; // hexstr position
-    u32 i = 0; // data position
-
-    if (str_len % 2 == 1) {
-        data[i] = (u8)(hex_lut[0] << 4) | hex_lut[(u8)hexstr[j]];
-        j = ++i;
-    }
-
-    for (; j < str_len; j += 2, i++) {
-        data[i] = (u8)(hex_lut[(u8)hexstr[j]] << 4) |
-                  hex_lut[(u8)hexstr[j + 1]];
-    }
-
-    *size = data_len;
-    return data;
-}
-
 void sys_proc_rw(u64 address, void *data, u64 length) {
     struct proc_rw process_rw_data;
     process_rw_data.address = address;
@@ -119,6 +67,16 @@ void sys_proc_rw(u64 address, void *data, u64 length) {
     return;
 }
 
+// Read through the kernel, a bad address fails the call instead of faulting the game
+bool sys_proc_read(u64 address, void *data, u64 length) {
+    struct proc_rw process_rw_data;
+    process_rw_data.address = address;
+    process_rw_data.data = data;
+    process_rw_data.length = length;
+    process_rw_data.write_flags = 0;
+    return sys_sdk_proc_rw(&process_rw_data) == 0;
+}
+
 bool hex_prefix(const char *str)
 {
     if ((str[0] == '0' && str[1] == 'x') || (str[0] == '0' && str[1] == 'X'))
@@ -127,15 +85,6 @@ bool hex_prefix(const char *str)
         return false;
 }
 
-// http://www.cse.yorku.ca/~oz/hash.html
-constexpr u64 djb2_hash(const char *str) {
-    u64 hash = 5381;
-    u32 c = 0;
-    while ((c = *str++))
-        hash = hash * 33 ^ c;
-    return hash;
-}
-
 u64 patch_hash_calc(const char *title, const char *name, const char *app_ver,
                     const char *title_id, const char *elf) {
     u64 output_hash = 0;
@@ -148,122 +97,392 @@ u64 patch_hash_calc(const char *title, const char *name, const char *app_ver,
     return output_hash;
 }
 
-void patch_data1(const char* patch_type_str, u64 addr, const char *value, uint32_t source_size, uint64_t jump_target) {
-    s32 str_base = 16;
-    memset(arr8,  0, sizeof(arr8));
-    memset(arr16, 0, sizeof(arr16));
-    memset(arr32, 0, sizeof(arr32));
-    memset(arr64, 0, sizeof(arr64));
-    u64 patch_type = djb2_hash(patch_type_str);
+/*
+ * @brief Check a Metadata AppVer against the running app version
+ *
+ * `mask` and `all` match any version. An empty AppVer matches when the
+ * entry has an AppFingerprint, which is then checked on its own.
+ */
+bool app_ver_matches(const char *game_ver, const char *AppVerData, bool has_fingerprint)
+{
+    if (has_fingerprint && !AppVerData[0])
+    {
+        debug_printf("App ver not set, matched by fingerprint\n");
+        return true;
+    }
+    if (!strncmp(game_ver, AppVerData, 5))
+    {
+        debug_printf("App ver %s == %s\n", game_ver, AppVerData);
+        return true;
+    }
+    else if (!strncmp("mask", AppVerData, 4) || !strncmp("all", AppVerData, 3))
+    {
+        debug_printf("App ver masked: %s\n", AppVerData);
+        return true;
+    }
+    debug_printf("App ver %s != %s\n", game_ver, AppVerData);
+    return false;
+}
+
+/*
+ * @brief Decode a patch value to the bytes that are written to memory
+ *
+ * @param patch_type djb2_hash() of the patch type
+ * @param value      Value attribute of the patch line
+ * @param out        Arena the bytes are appended to
+ * @param size       Number of bytes appended
+ * @returns          false if the patch type is not supported or the value is invalid
+ */
+bool patch_value_decode(u64 patch_type, const char *value, byte_buffer_t *out, u32 *size) {
+    s32 str_base = hex_prefix(value) ? 16 : 10;
     switch(patch_type)
     {
         case djb2_hash("byte"):
         {
-            u8 real_value = 0;
-            if (hex_prefix(value)) {
-                real_value = strtol(value, NULL, str_base);
-            } else {
-                str_base = 10;
-                real_value = strtol(value, NULL, str_base);
-            }
-            memcpy(arr8, &real_value, sizeof(arr8));
-            sys_proc_rw(addr, arr8, sizeof(arr8));
-            return;
+            u8 real_value = strtol(value, NULL, str_base);
+            *size = sizeof(real_value);
+            buffer_append(out, &real_value, *size);
+            return true;
         }
         case djb2_hash("bytes16"):
         {
-            u16 real_value = 0;
-            if (hex_prefix(value)) {
-                real_value = strtol(value, NULL, str_base);
-            } else {
-                str_base = 10;
-                real_value = strtol(value, NULL, str_base);
-            }
-            memcpy(arr16, &real_value, sizeof(arr16));
-            sys_proc_rw(addr, arr16, sizeof(arr16));
-            return;
+            u16 real_value = strtol(value, NULL, str_base);
+            *size = sizeof(real_value);
+            buffer_append(out, &real_value, *size);
+            return true;
         }
         case djb2_hash("bytes32"):
         {
-            u32 real_value = 0;
-            if (hex_prefix(value)) {
-                real_value = strtol(value, NULL, str_base);
-            } else {
-                str_base = 10;
-                real_value = strtol(value, NULL, str_base);
-            }
-            memcpy(arr32, &real_value, sizeof(arr32));
-            sys_proc_rw(addr, arr32, sizeof(arr32));
-            return;
+            u32 real_value = strtol(value, NULL, str_base);
+            *size = sizeof(real_value);
+            buffer_append(out, &real_value, *size);
+            return true;
         }
         case djb2_hash("bytes64"):
         {
-            s64 real_value = 0;
-            if (hex_prefix(value)) {
-                real_value = strtoll(value, NULL, str_base);
-            } else {
-                str_base = 10;
-                real_value = strtoll(value, NULL, str_base);
-            }
-            memcpy(arr64, &real_value, sizeof(arr64));
-            sys_proc_rw(addr, arr64, sizeof(arr64));
-            return;
-        }
-        case djb2_hash("bytes"):
-        {
-            s64 bytearray_size = 0;
-            u8 *bytearray = hexstrtochar2(value, &bytearray_size);
-            sys_proc_rw(addr, bytearray, bytearray_size);
-            free(bytearray);
-            return;
+            s64 real_value = strtoll(value, NULL, str_base);
+            *size = sizeof(real_value);
+            buffer_append(out, &real_value, *size);
+            return true;
         }
         case djb2_hash("float32"):
         {
-            f32 real_value = 0;
-            real_value = strtod(value, NULL);
-            memcpy(arr32, &real_value, sizeof(arr32));
-            sys_proc_rw(addr, arr32, sizeof(arr32));
-            return;
+            f32 real_value = strtod(value, NULL);
+            *size = sizeof(real_value);
+            buffer_append(out, &real_value, *size);
+            return true;
         }
         case djb2_hash("float64"):
         {
-            f64 real_value = 0;
-            real_value = strtod(value, NULL);
-            memcpy(arr64, &real_value, sizeof(arr64));
-            sys_proc_rw(addr, arr64, sizeof(arr64));
-            return;
+            f64 real_value = strtod(value, NULL);
+            *size = sizeof(real_value);
+            buffer_append(out, &real_value, *size);
+            return true;
+        }
+        case djb2_hash("bytes"):
+        case djb2_hash("mask"):
+        case djb2_hash("mask_jump32"):
+        {
+            u64 len = strlen(value);
+            u64 decoded = 0;
+            u64 error_pos = 0;
+            u8 *dst = buffer_reserve(out, hex_decoded_max(len));
+            if (!hex_decode(value, len, dst, &decoded, &error_pos))
+            {
+                final_printf("Invalid hex character '%c' at %lu in \"%s\"\n", value[error_pos], error_pos, value);
+                return false;
+            }
+            out->size += decoded;
+            *size = decoded;
+            return true;
         }
         case djb2_hash("utf8"):
         {
             char* new_str = unescape(value);
-            u64 char_len = strlen(new_str);
-            sys_proc_rw(addr, (void*)new_str, char_len + 1); // get null
+            *size = strlen(new_str) + 1; // get null
+            buffer_append(out, new_str, *size);
             free(new_str);
-            return;
+            return true;
         }
         case djb2_hash("utf16"):
         {
             char* new_str = unescape(value);
-            for (u32 i = 0; new_str[i] != '\x00'; i++)
+            u64 char_len = strlen(new_str);
+            *size = (char_len + 1) * 2;
+            u8 *dst = buffer_reserve(out, *size);
+            for (u64 i = 0; i <= char_len; i++)
             {
-                u8 val_ = new_str[i];
-                u8 value_[2] = {val_, 0x00};
-                sys_proc_rw(addr, value_, sizeof(value_));
-                addr = addr + 2;
+                dst[i * 2] = new_str[i];
+                dst[i * 2 + 1] = 0x00;
             }
-            u8 value_[2] = {0x00, 0x00};
-            sys_proc_rw(addr, value_, sizeof(value_));
+            out->size += *size;
             free(new_str);
-            return;
+            return true;
         }
-        case djb2_hash("mask"):
-        {
-            s64 bytearray_size = 0;
-            u8 *bytearray = hexstrtochar2(value, &bytearray_size);
-            sys_proc_rw(addr, bytearray, bytearray_size);
-            free(bytearray);
-            return;
+    }
+    return false;
+}
+
+/*
+ * @brief Queue a write, `data` is copied
+ */
+void write_batch_add(write_batch_t *batch, u64 addr, const void *data, u32 size) {
+    if (!size) {
+        return;
+    }
+    if ((batch->size % 64) == 0) {
+        batch->op = (write_op_t *)realloc(batch->op, (64 + batch->size) * sizeof(write_op_t));
+    }
+    if (batch->data_size + size > batch->data_capacity) {
+        while (batch->data_size + size > batch->data_capacity) {
+            batch->data_capacity = batch->data_capacity ? batch->data_capacity * 2 : 4096;
         }
+        batch->data = (u8 *)realloc(batch->data, batch->data_capacity);
+    }
+    write_op_t *op = &batch->op[batch->size++];
+    op->addr = addr;
+    op->data = batch->data_size;
+    op->size = size;
+    op->span = 0;
+    op->owner = batch->owner ? batch->owner : "";
+    op->tag = batch->tag;
+    memcpy(batch->data + batch->data_size, data, size);
+    batch->data_size += size;
+}
+
+static int write_op_cmp(const void *a, const void *b) {
+    const write_op_t *op_a = *(const write_op_t **)a;
+    const write_op_t *op_b = *(const write_op_t **)b;
+    if (op_a->addr != op_b->addr) {
+        return op_a->addr < op_b->addr ? -1 : 1;
+    }
+    return op_a < op_b ? -1 : 1; // keep queue order for equal addresses
+}
+
+/*
+ * @brief Apply and clear all queued writes
+ *
+ * Writes are sorted by address and adjacent or overlapping writes are
+ * merged into one span. Bytes are copied into the spans in queue order,
+ * so where writes overlap the last queued one wins, the same as writing
+ * them one by one. Overlaps between writes of different tags are
+ * reported with both owner names.
+ *
+ * With WRITE_MODE_DIRECT spans are written in process, with one
+ * protection change per mapping, and only spans that can't be remapped
+ * go through sys_proc_rw().
+ *
+ * With an undo log the spans are first read with sys_proc_read(), a span
+ * that can't be read is not written. Each write records the bytes it
+ * replaces under its tag, including those of writes queued before it, so
+ * restoring writes newest first gives back the bytes of each step.
+ *
+ * @returns Number of spans written
+ */
+u32 write_batch_flush(write_batch_t *batch) {
+    if (!batch->size) {
+        return 0;
+    }
+    write_op_t **sorted = (write_op_t **)malloc(batch->size * sizeof(write_op_t *));
+    for (u32 i = 0; i < batch->size; i++) {
+        sorted[i] = &batch->op[i];
+    }
+    qsort(sorted, batch->size, sizeof(write_op_t *), write_op_cmp);
+
+    // span_addr[n], span_size[n] and span_data[n] describe merged span n
+    u64 *span_addr = (u64 *)malloc(batch->size * sizeof(u64));
+    u64 *span_size = (u64 *)malloc(batch->size * sizeof(u64));
+    u64 *span_data = (u64 *)malloc(batch->size * sizeof(u64));
+    u32 spans = 0;
+    u64 total = 0;
+    u32 span_first = 0; // first sorted op of the current span
+    u32 conflicts = 0;
+    for (u32 i = 0; i < batch->size; i++) {
+        write_op_t *op = sorted[i];
+        u64 end = op->addr + op->size;
+        if (spans && op->addr < span_addr[spans - 1] + span_size[spans - 1]) {
+            // only ops of the current span can overlap this one, each other tag is reported once,
+            // patches are told apart by tag since two entries can share a name
+            bool reported = false;
+            u32 reported_tag = 0;
+            for (u32 j = span_first; j < i; j++) {
+                const write_op_t *prev = sorted[j];
+                if (prev->addr + prev->size > op->addr && prev->tag != op->tag &&
+                    (!reported || reported_tag != prev->tag)) {
+                    reported = true;
+                    reported_tag = prev->tag;
+                    const write_op_t *winner = prev > op ? prev : op;
+                    final_printf("Conflict: \"%s\" and \"%s\" both write 0x%lx-0x%lx, \"%s\" wins\n",
+                                 prev->owner, op->owner, op->addr,
+                                 (end < prev->addr + prev->size ? end : prev->addr + prev->size) - 1, winner->owner);
+                    conflicts++;
+                }
+            }
+        }
+        if (!spans || op->addr > span_addr[spans - 1] + span_size[spans - 1]) {
+            span_first = i;
+        }
+        if (spans && op->addr <= span_addr[spans - 1] + span_size[spans - 1]) {
+            u64 span_end = span_addr[spans - 1] + span_size[spans - 1];
+            if (end > span_end) {
+                span_size[spans - 1] += end - span_end;
+            }
+        } else {
+            span_addr[spans] = op->addr;
+            span_size[spans] = op->size;
+            spans++;
+        }
+        op->span = spans - 1;
+    }
+    for (u32 i = 0; i < spans; i++) {
+        span_data[i] = total;
+        total += span_size[i];
+    }
+    u8 *merged = (u8 *)malloc(total);
+    u8 *span_skip = nullptr;
+    u32 skipped = 0;
+    if (batch->undo) {
+        span_skip = (u8 *)calloc(spans, sizeof(u8));
+        for (u32 i = 0; i < spans; i++) {
+            if (!sys_proc_read(span_addr[i], merged + span_data[i], span_size[i])) {
+                final_printf("Undo: could not read 0x%lx-0x%lx, its writes are skipped\n",
+                             span_addr[i], span_addr[i] + span_size[i] - 1);
+                span_skip[i] = 1;
+                skipped++;
+            }
+        }
+    }
+    undo_log_t *log = batch->undo;
+    for (u32 i = 0; i < batch->size; i++) {
+        const write_op_t *op = &batch->op[i];
+        u8 *dest = merged + span_data[op->span] + (op->addr - span_addr[op->span]);
+        if (log && !span_skip[op->span]) {
+            if ((log->size % 64) == 0) {
+                log->record = (undo_record_t *)realloc(log->record, (64 + log->size) * sizeof(undo_record_t));
+            }
+            undo_record_t *record = &log->record[log->size++];
+            record->addr = op->addr;
+            record->size = op->size;
+            record->tag = op->tag;
+            // in queue order, the span holds the original bytes plus the writes queued before this one
+            record->data = buffer_append(&log->data, dest, op->size);
+        }
+        memcpy(dest, batch->data + op->data, op->size);
+    }
+    u32 fallback = 0;
+    u8 *span_direct = nullptr;
+    if (batch->mode == WRITE_MODE_DIRECT) {
+        span_direct = (u8 *)calloc(spans, sizeof(u8));
+        mem_write_direct_spans(span_addr, span_size, merged, span_data, span_skip, spans, span_direct);
+    }
+    for (u32 i = 0; i < spans; i++) {
+        if ((span_skip && span_skip[i]) || (span_direct && span_direct[i])) {
+            continue;
+        }
+        if (batch->mode == WRITE_MODE_DIRECT) {
+            debug_printf("Direct write to 0x%lx failed, using proc_rw\n", span_addr[i]);
+            fallback++;
+        }
+        sys_proc_rw(span_addr[i], merged + span_data[i], span_size[i]);
+    }
+    final_printf("Writes: %u queued, %u issued, %u saved\n", batch->size, spans - skipped, batch->size - spans);
+    if (batch->mode == WRITE_MODE_DIRECT) {
+        final_printf("Direct writes: %u, proc_rw fallbacks: %u\n", spans - skipped - fallback, fallback);
+    }
+
+    free(span_direct);
+    free(span_skip);
+    free(merged);
+    free(span_data);
+    free(span_size);
+    free(span_addr);
+    free(sorted);
+    free(batch->op);
+    free(batch->data);
+    write_mode_t mode = batch->mode;
+    memset(batch, 0, sizeof(*batch));
+    batch->mode = mode;
+    batch->conflicts = conflicts;
+    return spans - skipped;
+}
+
+/*
+ * @brief Queue the writes that undo every record with `tag`
+ *
+ * Records are queued newest first so where they overlap the oldest bytes
+ * win, and are then dropped from the log.
+ *
+ * @returns Number of records queued
+ */
+u32 undo_log_restore(undo_log_t *log, write_batch_t *batch, u32 tag) {
+    u32 restored = 0;
+    u32 kept = 0;
+    for (u32 i = log->size; i-- > 0;) {
+        const undo_record_t *record = &log->record[i];
+        if (record->tag == tag) {
+            write_batch_add(batch, record->addr, log->data.data + record->data, record->size);
+            restored++;
+        }
+    }
+    for (u32 i = 0; i < log->size; i++) {
+        if (log->record[i].tag != tag) {
+            log->record[kept++] = log->record[i];
+        }
+    }
+    log->size = kept;
+    if (!kept) {
+        // bytes of dropped records are only reclaimed once the log is empty
+        log->data.size = 0;
+    }
+    return restored;
+}
+
+/*
+ * @brief Find a newer record of another tag that overlaps a record with `tag`
+ *
+ * Restoring `tag` first would write its old bytes over that newer write.
+ *
+ * @param newer_tag Tag of the first such record
+ * @returns         false if there is none
+ */
+bool undo_log_overlapped(const undo_log_t *log, u32 tag, u32 *newer_tag) {
+    for (u32 i = 0; i < log->size; i++) {
+        const undo_record_t *record = &log->record[i];
+        if (record->tag != tag) {
+            continue;
+        }
+        for (u32 j = i + 1; j < log->size; j++) {
+            const undo_record_t *newer = &log->record[j];
+            if (newer->tag != tag && newer->addr < record->addr + record->size &&
+                record->addr < newer->addr + newer->size) {
+                *newer_tag = newer->tag;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void undo_log_free(undo_log_t *log) {
+    free(log->record);
+    buffer_free(&log->data);
+    memset(log, 0, sizeof(*log));
+}
+
+/*
+ * @brief Queue the writes of a decoded patch value
+ *
+ * @param batch       Write batch
+ * @param patch_type  djb2_hash() of the patch type
+ * @param addr        Address to patch
+ * @param data        Value decoded by patch_value_decode()
+ * @param size        Size of `data`
+ * @param source_size mask_jump32: bytes replaced by the jump
+ * @param jump_target mask_jump32: code cave address
+ */
+void patch_data1(write_batch_t *batch, u64 patch_type, u64 addr, const u8 *data, s64 size, u32 source_size, u64 jump_target) {
+    switch(patch_type)
+    {
         case djb2_hash("mask_jump32"):
         {
             if (source_size < 5)
@@ -271,31 +490,25 @@ void patch_data1(const char* patch_type_str, u64 addr, const char *value, uint32
                 final_printf("Can't create code cave with size less than 32 bit jump!\n");
                 return;
             }
-            s64 bytearray_size = 0;
-            u8 *bytearray = hexstrtochar2(value, &bytearray_size);
-            u64 code_cave_end = jump_target + bytearray_size;
-            for (uint32_t i = 0; i < source_size; i++)
-            {
-                u8 nop_byte[] = { 0x90 };
-                sys_proc_rw(addr + i, nop_byte, sizeof(nop_byte));
-            }
+            u64 code_cave_end = jump_target + size;
+            u8 *nop_bytes = (u8 *)malloc(source_size);
+            memset(nop_bytes, 0x90, source_size);
+            write_batch_add(batch, addr, nop_bytes, source_size);
+            free(nop_bytes);
             u8 jump_32[] = { 0xe9, 0x00, 0x00, 0x00, 0x00 };
             s32 target_jmp = (s32) (jump_target - addr - 5);
             s32 target_return = (s32) (addr) - (code_cave_end);
-            sys_proc_rw(jump_target, bytearray, bytearray_size);
-            sys_proc_rw(addr, jump_32, sizeof(jump_32));
-            memcpy(arr32, &target_jmp, sizeof(target_jmp));
-            sys_proc_rw(addr + 1, arr32, sizeof(arr32));
-            sys_proc_rw(jump_target + bytearray_size, jump_32, sizeof(jump_32));
-            memcpy(arr32, &target_return, sizeof(target_return));
-            sys_proc_rw(code_cave_end + 1, arr32, sizeof(arr32));
-            free(bytearray);
+            write_batch_add(batch, jump_target, data, size);
+            memcpy(jump_32 + 1, &target_jmp, sizeof(target_jmp));
+            write_batch_add(batch, addr, jump_32, sizeof(jump_32));
+            memcpy(jump_32 + 1, &target_return, sizeof(target_return));
+            write_batch_add(batch, code_cave_end, jump_32, sizeof(jump_32));
             return;
         }
         default:
         {
-            final_printf("Patch type: %s not found or unsupported\n", patch_type_str);
+            write_batch_add(batch, addr, data, size);
+            return;
         }
     }
-    return;
 }
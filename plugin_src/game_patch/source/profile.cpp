@@ -0,0 +1,82 @@
+#include "profile.h"
+
+#if defined(__linux__)
+#include <time.h>
+#endif
+
+profile_t g_profile = {};
+
+static const char *profile_phase_name[PROF_PHASE_COUNT] = {
+    "file_io", "parse", "settings", "scan", "write",
+};
+
+/*
+ * @brief Monotonic time in microseconds
+ */
+u64 profile_now(void)
+{
+#if defined(__linux__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+    return sceKernelGetProcessTime();
+#endif
+}
+
+void profile_print(const profile_t *profile)
+{
+    final_printf("Profile: boot %lu us, total %lu us\n", profile->boot_us, profile->total_us);
+    for (u32 i = 0; i < PROF_PHASE_COUNT; i++)
+    {
+        final_printf("Profile: %-8s %lu us\n", profile_phase_name[i], profile->phase_us[i]);
+    }
+    final_printf("Profile: %lu bytes scanned, %u/%u signatures resolved (%u cached), %u writes queued, %u issued, %u conflicts\n",
+                 profile->bytes_scanned, profile->patterns_resolved, profile->patterns, profile->patterns_cached,
+                 profile->writes_queued, profile->writes_issued, profile->write_conflicts);
+}
+
+/*
+ * @brief Append one csv row per boot, the header is written when the file is created
+ *
+ * @param profile Collected timings and counters
+ * @param path    Log file
+ * @param titleid Title id of the running game
+ * @param elf     Executable name
+ * @param ver     App version
+ */
+void profile_write(const profile_t *profile, const char *path, const char *titleid, const char *elf, const char *ver)
+{
+    OrbisKernelStat st;
+    bool exists = sceKernelStat(path, &st) == 0 && st.st_size > 0;
+    s32 fd = sceKernelOpen(path, 0x200 | 0x008 | 0x001, 0777); // O_CREAT | O_APPEND | O_WRONLY
+    if (fd < 0)
+    {
+        debug_printf("Failed to open profile log \"%s\" 0x%08x\n", path, fd);
+        return;
+    }
+    char row[512];
+    s32 len = 0;
+    if (!exists)
+    {
+        len = snprintf(row, sizeof(row), "title_id,elf,app_ver,boot_us,total_us");
+        for (u32 i = 0; i < PROF_PHASE_COUNT; i++)
+        {
+            len += snprintf(row + len, sizeof(row) - len, ",%s_us", profile_phase_name[i]);
+        }
+        len += snprintf(row + len, sizeof(row) - len,
+                        ",bytes_scanned,signatures,signatures_cached,signatures_resolved,writes_queued,writes_issued,write_conflicts\n");
+        sceKernelWrite(fd, row, len);
+    }
+    len = snprintf(row, sizeof(row), "%s,%s,%s,%lu,%lu", titleid, elf, ver, profile->boot_us, profile->total_us);
+    for (u32 i = 0; i < PROF_PHASE_COUNT; i++)
+    {
+        len += snprintf(row + len, sizeof(row) - len, ",%lu", profile->phase_us[i]);
+    }
+    len += snprintf(row + len, sizeof(row) - len, ",%lu,%u,%u,%u,%u,%u,%u\n",
+                    profile->bytes_scanned, profile->patterns, profile->patterns_cached,
+                    profile->patterns_resolved, profile->writes_queued, profile->writes_issued,
+                    profile->write_conflicts);
+    sceKernelWrite(fd, row, len);
+    sceKernelClose(fd);
+}
@@ -0,0 +1,783 @@
+#include "scan.h"
+#include "patch.h"
+#include "thread.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Most frequent bytes in x86-64 code, most common first.
+// Anything not listed is treated as rare and makes a good anchor.
+static const u8 common_bytes[] = {
+    0x00, 0xff, 0x48, 0x8b, 0x89, 0x0f, 0xe8, 0x4c, 0x24, 0x45, 0x85, 0xc0,
+    0x01, 0x83, 0x74, 0x8d, 0x75, 0x49, 0x41, 0x44, 0x10, 0x08, 0xcc, 0x90,
+    0xeb, 0xc3, 0x5d, 0x55, 0xe9, 0x84, 0x20, 0x40, 0x04, 0x18, 0x02, 0x28,
+};
+
+static u32 byte_commonness(u8 b)
+{
+    for (u32 i = 0; i < sizeof(common_bytes); i++)
+    {
+        if (common_bytes[i] == b)
+        {
+            return sizeof(common_bytes) - i;
+        }
+    }
+    return 0;
+}
+
+/*
+ * @brief Convert IDA-style pattern to bytes and mask, pick anchor bytes
+ *
+ * @param signature IDA-style byte array pattern, `?` or `??` for wildcards
+ * @param pattern   Output pattern
+ * @returns         true if the pattern has at least one fixed byte
+ */
+bool pattern_compile(const char* signature, pattern_t* pattern)
+{
+    s32 count = 0;
+    const char* current = signature;
+    const char* end = signature + strlen(signature);
+
+    while (current < end)
+    {
+        if (*current == ' ')
+        {
+            ++current;
+            continue;
+        }
+        if (count >= (s32)MAX_PATTERN_LENGTH)
+        {
+            final_printf("Pattern length too large! (max %u)\n", MAX_PATTERN_LENGTH);
+            final_printf("Input Pattern %s\n", signature);
+            return false;
+        }
+        if (*current == '?')
+        {
+            ++current;
+            if (*current == '?')
+            {
+                ++current;
+            }
+            pattern->bytes[count] = 0;
+            pattern->mask[count++] = 0x00;
+        }
+        else
+        {
+            char* next = nullptr;
+            pattern->bytes[count] = (u8)strtoul(current, &next, 16);
+            pattern->mask[count++] = 0xff;
+            if (next == current)
+            {
+                final_printf("Invalid character '%c' in pattern %s\n", *current, signature);
+                return false;
+            }
+            current = next;
+        }
+    }
+    pattern->length = count;
+    pattern->anchor[0] = pattern->anchor[1] = -1;
+
+    u32 best[2] = { ~0u, ~0u };
+    for (s32 i = 0; i < count; i++)
+    {
+        if (!pattern->mask[i])
+        {
+            continue;
+        }
+        u32 score = byte_commonness(pattern->bytes[i]);
+        if (score < best[0])
+        {
+            best[1] = best[0];
+            pattern->anchor[1] = pattern->anchor[0];
+            best[0] = score;
+            pattern->anchor[0] = i;
+        }
+        else if (score < best[1])
+        {
+            best[1] = score;
+            pattern->anchor[1] = i;
+        }
+    }
+    if (pattern->anchor[0] < 0)
+    {
+        final_printf("Pattern has no fixed bytes: %s\n", signature);
+        return false;
+    }
+    if (pattern->anchor[1] < 0)
+    {
+        pattern->anchor[1] = pattern->anchor[0];
+    }
+    return true;
+}
+
+static inline bool pattern_match(const pattern_t* pattern, const u8* data)
+{
+    s32 i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= pattern->length; i += 16)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i p = _mm_loadu_si128((const __m128i*)(pattern->bytes + i));
+        __m128i m = _mm_loadu_si128((const __m128i*)(pattern->mask + i));
+        __m128i diff = _mm_and_si128(_mm_xor_si128(d, p), m);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xffff)
+        {
+            return false;
+        }
+    }
+#endif
+    for (; i < pattern->length; i++)
+    {
+        if ((data[i] ^ pattern->bytes[i]) & pattern->mask[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * @brief Find the first occurrence of a compiled pattern
+ *
+ * Candidates are found by comparing the two anchor bytes a vector at a time,
+ * only those positions are checked against the full wildcard mask.
+ *
+ * @param pattern Compiled pattern
+ * @param base    Start of the memory range to search
+ * @param size    Size of the memory range to search
+ * @returns       Address of the first occurrence
+ */
+u8* pattern_find(const pattern_t* pattern, u64 base, u64 size)
+{
+    if (!base || (u64)pattern->length > size)
+    {
+        return nullptr;
+    }
+    const u8* data = (const u8*)base;
+    const u64 last = size - pattern->length; // last valid start position
+    const s32 a0 = pattern->anchor[0];
+    const s32 a1 = pattern->anchor[1];
+    const u8 b0 = pattern->bytes[a0];
+    const u8 b1 = pattern->bytes[a1];
+    u64 i = 0;
+
+#if defined(__AVX2__)
+    const __m256i v0 = _mm256_set1_epi8((char)b0);
+    const __m256i v1 = _mm256_set1_epi8((char)b1);
+    for (; i + 32 <= last + 1; i += 32)
+    {
+        __m256i c0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + i + a0)), v0);
+        __m256i c1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + i + a1)), v1);
+        u32 bits = (u32)_mm256_movemask_epi8(_mm256_and_si256(c0, c1));
+        while (bits)
+        {
+            u32 bit = __builtin_ctz(bits);
+            if (pattern_match(pattern, data + i + bit))
+            {
+                return (u8*)(data + i + bit);
+            }
+            bits &= bits - 1;
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i v0 = _mm_set1_epi8((char)b0);
+    const __m128i v1 = _mm_set1_epi8((char)b1);
+    for (; i + 16 <= last + 1; i += 16)
+    {
+        __m128i c0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i + a0)), v0);
+        __m128i c1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i + a1)), v1);
+        u32 bits = (u32)_mm_movemask_epi8(_mm_and_si128(c0, c1));
+        while (bits)
+        {
+            u32 bit = __builtin_ctz(bits);
+            if (pattern_match(pattern, data + i + bit))
+            {
+                return (u8*)(data + i + bit);
+            }
+            bits &= bits - 1;
+        }
+    }
+#endif
+    // scalar fallback and remaining tail
+    for (; i <= last; i++)
+    {
+        if (data[i + a0] == b0 && data[i + a1] == b1 && pattern_match(pattern, data + i))
+        {
+            return (u8*)(data + i);
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * @brief Scan for a given byte pattern on a module
+ *
+ * @param module_base Base of the module to search
+ * @param module_size Size of the module to search
+ * @param signature   IDA-style byte array pattern
+ * @credit            https://github.com/OneshotGH/CSGOSimple-master/blob/59c1f2ec655b2fcd20a45881f66bbbc9cd0e562e/CSGOSimple/helpers/utils.cpp#L182
+ * @returns           Address of the first occurrence
+ */
+u8* PatternScan(u64 module_base, u32 module_size, const char* signature)
+{
+    if (!module_base || !module_size)
+    {
+        return nullptr;
+    }
+    pattern_t pattern;
+    if (!pattern_compile(signature, &pattern))
+    {
+        return nullptr;
+    }
+    return pattern_find(&pattern, module_base, module_size);
+}
+
+static bool pattern_equal(const pattern_t *a, const pattern_t *b)
+{
+    if (a->length != b->length || memcmp(a->mask, b->mask, a->length))
+    {
+        return false;
+    }
+    for (s32 i = 0; i < a->length; i++)
+    {
+        if ((a->bytes[i] ^ b->bytes[i]) & a->mask[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * @brief Add a signature to the table, identical signatures share one entry
+ *
+ * @param table     Signature table
+ * @param signature IDA-style byte array pattern
+ * @returns         Index of the entry, -1 if the table could not grow
+ */
+s32 sig_table_add(sig_table_t *table, const char *signature)
+{
+    if ((table->size % 16) == 0)
+    {
+        sig_entry_t *entry = (sig_entry_t *)realloc(table->entry, (16 + table->size) * sizeof(sig_entry_t));
+        if (!entry)
+        {
+            return -1;
+        }
+        table->entry = entry;
+    }
+    // compiled into the next free slot, which is only kept if no entry matches
+    sig_entry_t *entry = &table->entry[table->size];
+    entry->hash = djb2_hash(signature);
+    entry->result = 0;
+    entry->next = -1;
+    entry->resolved = false;
+    entry->valid = pattern_compile(signature, &entry->pattern);
+    entry->hash_shared = false;
+    for (u32 i = 0; i < table->size; i++)
+    {
+        sig_entry_t *other = &table->entry[i];
+        if (other->hash != entry->hash)
+        {
+            continue;
+        }
+        // the hash only narrows the candidates, colliding strings must also compile to the same pattern
+        if (other->valid == entry->valid && (!entry->valid || pattern_equal(&other->pattern, &entry->pattern)))
+        {
+            return i;
+        }
+        other->hash_shared = true;
+        entry->hash_shared = true;
+    }
+    return table->size++;
+}
+
+// Occurrences of one 4 byte gram in the range, in ascending order
+struct sig_gram_t
+{
+    u32 key;
+    u32 count;
+    u32 *offset;
+    bool used;
+    bool overflow; // more than SIG_GRAM_MAX_HITS occurrences, not usable for lookups
+};
+
+// Gram index of a memory range, only grams used by pending signatures are recorded
+struct sig_index_t
+{
+    sig_gram_t *gram; // open addressing table of `mask + 1` slots
+    u32 mask;
+    u32 shift;
+    u64 filter[1024]; // one bit per 16 bit key hash, rejects most positions without a table lookup
+};
+
+// Grams picked for one signature, gram_pos is their offset in the pattern
+struct sig_lookup_t
+{
+    s32 gram[2];
+    s32 gram_pos[2];
+};
+
+static inline u32 gram_hash(u32 key)
+{
+    return key * 2654435761u;
+}
+
+static inline u32 gram_load(const u8 *data)
+{
+    u32 key;
+    memcpy(&key, data, sizeof(key));
+    return key;
+}
+
+static s32 sig_index_insert(sig_index_t *index, u32 key)
+{
+    u32 hash = gram_hash(key);
+    u32 slot = hash >> index->shift;
+    while (index->gram[slot].used && index->gram[slot].key != key)
+    {
+        slot = (slot + 1) & index->mask;
+    }
+    index->gram[slot].used = true;
+    index->gram[slot].key = key;
+    index->filter[(hash >> 16) / 64] |= 1ull << ((hash >> 16) % 64);
+    return slot;
+}
+
+/*
+ * @brief Pick the two rarest grams of a pattern
+ *
+ * Only windows of 4 fixed bytes can be grams.
+ * @returns false if the pattern has none
+ */
+static bool pattern_pick_grams(const pattern_t *pattern, s32 pos[2])
+{
+    u32 best[2] = { ~0u, ~0u };
+    pos[0] = pos[1] = -1;
+    for (s32 i = 0; i + 4 <= pattern->length; i++)
+    {
+        if (gram_load(pattern->mask + i) != ~0u)
+        {
+            continue;
+        }
+        u32 score = 0;
+        for (s32 j = 0; j < 4; j++)
+        {
+            score += byte_commonness(pattern->bytes[i + j]);
+        }
+        if (score < best[0])
+        {
+            best[1] = best[0];
+            pos[1] = pos[0];
+            best[0] = score;
+            pos[0] = i;
+        }
+        else if (score < best[1])
+        {
+            best[1] = score;
+            pos[1] = i;
+        }
+    }
+    return pos[0] >= 0;
+}
+
+/*
+ * @brief First match of a pattern among the candidates of its grams
+ *
+ * Candidates are starts where the first gram occurs, when there is a second
+ * gram the two sorted lists are intersected before any candidate is verified.
+ */
+static u64 sig_index_lookup(const sig_index_t *index, const sig_lookup_t *lookup, const pattern_t *pattern, u64 base, u64 size)
+{
+    const sig_gram_t *first = &index->gram[lookup->gram[0]];
+    const sig_gram_t *second = lookup->gram[1] >= 0 ? &index->gram[lookup->gram[1]] : nullptr;
+    const u8 *data = (const u8 *)base;
+    u32 j = 0;
+    for (u32 i = 0; i < first->count; i++)
+    {
+        if (first->offset[i] < (u32)lookup->gram_pos[0])
+        {
+            continue;
+        }
+        u64 start = first->offset[i] - lookup->gram_pos[0];
+        if (start + pattern->length > size)
+        {
+            break;
+        }
+        if (second)
+        {
+            u64 want = start + lookup->gram_pos[1];
+            while (j < second->count && second->offset[j] < want)
+            {
+                j++;
+            }
+            if (j == second->count)
+            {
+                break;
+            }
+            if (second->offset[j] != want)
+            {
+                continue;
+            }
+        }
+        if (pattern_match(pattern, data + start))
+        {
+            return base + start;
+        }
+    }
+    return 0;
+}
+
+/*
+ * @brief Resolve pending signatures through a gram index of the range
+ *
+ * The range is walked once to record where the grams of the pending
+ * signatures occur. Each signature is then looked up in the candidate
+ * lists of its grams. Signatures without usable grams are left pending.
+ *
+ * @returns Number of bytes walked
+ */
+static u64 sig_index_resolve(sig_table_t *table, u64 base, u64 size)
+{
+    sig_index_t index;
+    memset(index.filter, 0, sizeof(index.filter));
+    u32 slots = 16;
+    index.shift = 28;
+    while (slots < table->size * 4)
+    {
+        slots *= 2;
+        index.shift--;
+    }
+    index.mask = slots - 1;
+    index.gram = (sig_gram_t *)calloc(slots, sizeof(sig_gram_t));
+    sig_lookup_t *lookup = (sig_lookup_t *)malloc(table->size * sizeof(sig_lookup_t));
+    u32 indexed = 0;
+    for (u32 i = 0; i < table->size; i++)
+    {
+        sig_entry_t *entry = &table->entry[i];
+        lookup[i].gram[0] = lookup[i].gram[1] = -1;
+        lookup[i].gram_pos[0] = lookup[i].gram_pos[1] = -1;
+        if (!entry->valid || entry->resolved || !pattern_pick_grams(&entry->pattern, lookup[i].gram_pos))
+        {
+            continue;
+        }
+        for (u32 g = 0; g < 2; g++)
+        {
+            if (lookup[i].gram_pos[g] >= 0)
+            {
+                lookup[i].gram[g] = sig_index_insert(&index, gram_load(entry->pattern.bytes + lookup[i].gram_pos[g]));
+            }
+        }
+        indexed++;
+    }
+    if (!indexed || size < 4)
+    {
+        free(lookup);
+        free(index.gram);
+        return 0;
+    }
+
+    const u8 *data = (const u8 *)base;
+    for (u64 i = 0; i + 4 <= size; i++)
+    {
+        u32 key = gram_load(data + i);
+        u32 hash = gram_hash(key);
+        if (!(index.filter[(hash >> 16) / 64] & (1ull << ((hash >> 16) % 64))))
+        {
+            continue;
+        }
+        for (u32 slot = hash >> index.shift; index.gram[slot].used; slot = (slot + 1) & index.mask)
+        {
+            sig_gram_t *gram = &index.gram[slot];
+            if (gram->key != key)
+            {
+                continue;
+            }
+            if (gram->overflow)
+            {
+                break;
+            }
+            if (gram->count == SIG_GRAM_MAX_HITS)
+            {
+                gram->overflow = true;
+                free(gram->offset);
+                gram->offset = nullptr;
+                break;
+            }
+            if ((gram->count % 64) == 0)
+            {
+                gram->offset = (u32 *)realloc(gram->offset, (64 + gram->count) * sizeof(u32));
+            }
+            gram->offset[gram->count++] = (u32)i;
+            break;
+        }
+    }
+
+    for (u32 i = 0; i < table->size; i++)
+    {
+        sig_lookup_t *l = &lookup[i];
+        if (l->gram[0] < 0)
+        {
+            continue;
+        }
+        // drop overflowed grams, the rarer one goes first
+        if (l->gram[1] >= 0 && index.gram[l->gram[1]].overflow)
+        {
+            l->gram[1] = -1;
+        }
+        if (index.gram[l->gram[0]].overflow)
+        {
+            l->gram[0] = l->gram[1];
+            l->gram_pos[0] = l->gram_pos[1];
+            l->gram[1] = -1;
+        }
+        if (l->gram[0] < 0)
+        {
+            continue; // left for the sweep
+        }
+        if (l->gram[1] >= 0 && index.gram[l->gram[1]].count < index.gram[l->gram[0]].count)
+        {
+            s32 gram = l->gram[0];
+            s32 gram_pos = l->gram_pos[0];
+            l->gram[0] = l->gram[1];
+            l->gram_pos[0] = l->gram_pos[1];
+            l->gram[1] = gram;
+            l->gram_pos[1] = gram_pos;
+        }
+        sig_entry_t *entry = &table->entry[i];
+        entry->result = sig_index_lookup(&index, l, &entry->pattern, base, size);
+        entry->resolved = true;
+    }
+
+    for (u32 i = 0; i <= index.mask; i++)
+    {
+        free(index.gram[i].offset);
+    }
+    free(index.gram);
+    free(lookup);
+    return size;
+}
+
+/*
+ * @brief Resolve every pending signature of the table in one pass
+ *
+ * Entries are bucketed by the value of their first anchor byte. Each byte
+ * of the range is looked up in the bucket table once, so the range is
+ * walked a single time no matter how many signatures are pending.
+ * Entries leave their bucket as soon as they are found, the sweep ends
+ * when no entries are left.
+ *
+ * With SIG_INDEX_THRESHOLD or more pending entries a gram index of the
+ * range is built first, the sweep only handles what the index could not.
+ * Fewer entries are each found with pattern_find(), which beats the sweep
+ * until about a dozen patterns share it.
+ *
+ * @param table Signature table
+ * @param base  Start of the memory range to search
+ * @param size  Size of the memory range to search
+ * @returns     Number of bytes walked
+ */
+u64 sig_table_resolve(sig_table_t *table, u64 base, u64 size)
+{
+    u64 walked = 0;
+    u32 pending = 0;
+    for (u32 i = 0; i < table->size; i++)
+    {
+        pending += table->entry[i].valid && !table->entry[i].resolved;
+    }
+    if (base && pending >= SIG_INDEX_THRESHOLD && size <= 0xffffffff)
+    {
+        walked = sig_index_resolve(table, base, size);
+    }
+
+    s32 head[256];
+    pending = 0;
+    memset(head, -1, sizeof(head));
+    for (u32 i = 0; i < table->size; i++)
+    {
+        sig_entry_t *entry = &table->entry[i];
+        if (!entry->valid || entry->resolved)
+        {
+            continue;
+        }
+        u8 key = entry->pattern.bytes[entry->pattern.anchor[0]];
+        entry->next = head[key];
+        head[key] = i;
+        pending++;
+    }
+    if (!pending || !base)
+    {
+        return walked;
+    }
+    if (pending < SIG_INDEX_THRESHOLD)
+    {
+        // too few to share the sweep, the single pattern scanner is faster for each
+        for (u32 j = 0; j < table->size; j++)
+        {
+            sig_entry_t *entry = &table->entry[j];
+            if (!entry->valid || entry->resolved)
+            {
+                continue;
+            }
+            entry->result = (u64)pattern_find(&entry->pattern, base, size);
+            entry->resolved = true;
+            walked += entry->result ? entry->result - base + entry->pattern.length : size;
+        }
+        return walked;
+    }
+
+    const u8 *data = (const u8 *)base;
+    u64 i = 0;
+    for (; i < size && pending; i++)
+    {
+        s32 *link = &head[data[i]];
+        while (*link >= 0)
+        {
+            sig_entry_t *entry = &table->entry[*link];
+            const pattern_t *pattern = &entry->pattern;
+            const s32 a0 = pattern->anchor[0];
+            const s32 a1 = pattern->anchor[1];
+            if (i >= (u64)a0 && (i - a0) + pattern->length <= size &&
+                data[i - a0 + a1] == pattern->bytes[a1] &&
+                pattern_match(pattern, data + (i - a0)))
+            {
+                entry->result = (u64)(data + (i - a0));
+                entry->resolved = true;
+                *link = entry->next;
+                pending--;
+                continue;
+            }
+            link = &entry->next;
+        }
+    }
+    for (u32 j = 0; j < table->size; j++)
+    {
+        table->entry[j].resolved = table->entry[j].valid;
+    }
+    return walked + i;
+}
+
+struct scan_job_t
+{
+    sig_table_t table; // copy of the pending entries, results are merged afterwards
+    u64 base;
+    u64 size;
+    u64 walked;
+};
+
+static void *scan_job_run(void *arg)
+{
+    scan_job_t *job = (scan_job_t *)arg;
+    job->walked = sig_table_resolve(&job->table, job->base, job->size);
+    return NULL;
+}
+
+/*
+ * @brief Resolve the pending signatures of the table with several threads
+ *
+ * The range is split into one chunk per thread. Chunks overlap by the
+ * longest pending pattern minus one byte so no match is lost on a border.
+ * Each chunk is resolved with sig_table_resolve() on its own copy of the
+ * table. The first chunk, in address order, with a match gives the result,
+ * which is the same first occurrence a single thread would find.
+ *
+ * @param table   Signature table
+ * @param base    Start of the memory range to search
+ * @param size    Size of the memory range to search
+ * @param threads Number of threads, the calling thread scans the first chunk
+ * @returns       Number of bytes walked by all threads
+ */
+u64 sig_table_resolve_parallel(sig_table_t *table, u64 base, u64 size, u32 threads)
+{
+    s32 max_length = 0;
+    u32 pending = 0;
+    for (u32 i = 0; i < table->size; i++)
+    {
+        const sig_entry_t *entry = &table->entry[i];
+        if (entry->valid && !entry->resolved)
+        {
+            pending++;
+            if (entry->pattern.length > max_length)
+            {
+                max_length = entry->pattern.length;
+            }
+        }
+    }
+    if (threads > SCAN_MAX_THREADS)
+    {
+        threads = SCAN_MAX_THREADS;
+    }
+    if (threads > size / SCAN_MIN_CHUNK)
+    {
+        threads = size / SCAN_MIN_CHUNK;
+    }
+    if (!pending || !base || threads < 2)
+    {
+        return sig_table_resolve(table, base, size);
+    }
+
+    scan_job_t job[SCAN_MAX_THREADS];
+    thread_t thread[SCAN_MAX_THREADS];
+    bool started[SCAN_MAX_THREADS] = {};
+    const u64 chunk = (size + threads - 1) / threads;
+    for (u32 t = 0; t < threads; t++)
+    {
+        u64 start = t * chunk;
+        u64 end = start + chunk + max_length - 1;
+        job[t].base = base + start;
+        job[t].size = (end < size ? end : size) - start;
+        job[t].walked = 0;
+        job[t].table.size = table->size;
+        job[t].table.entry = (sig_entry_t *)malloc(table->size * sizeof(sig_entry_t));
+        memcpy(job[t].table.entry, table->entry, table->size * sizeof(sig_entry_t));
+    }
+    for (u32 t = 1; t < threads; t++)
+    {
+        started[t] = thread_start(&thread[t], scan_job_run, &job[t], "game_patch_scan");
+    }
+    scan_job_run(&job[0]);
+    u64 walked = job[0].walked;
+    for (u32 t = 1; t < threads; t++)
+    {
+        if (started[t])
+        {
+            thread_join(thread[t]);
+        }
+        else
+        {
+            scan_job_run(&job[t]);
+        }
+        walked += job[t].walked;
+    }
+
+    for (u32 i = 0; i < table->size; i++)
+    {
+        sig_entry_t *entry = &table->entry[i];
+        if (!entry->valid || entry->resolved)
+        {
+            continue;
+        }
+        entry->result = 0;
+        for (u32 t = 0; t < threads && !entry->result; t++)
+        {
+            entry->result = job[t].table.entry[i].result;
+        }
+        entry->resolved = true;
+    }
+    for (u32 t = 0; t < threads; t++)
+    {
+        sig_table_free(&job[t].table);
+    }
+    return walked;
+}
+
+void sig_table_free(sig_table_t *table)
+{
+    free(table->entry);
+    table->entry = nullptr;
+    table->size = 0;
+}
@@ -0,0 +1,916 @@
+#include "search.h"
+#include "memory.h"
+#include <emmintrin.h>
+
+// SSE2 lane operations of each value type, on 16 byte vectors.
+// Comparisons return all ones in matching lanes, mask() packs one bit per lane.
+struct lanes_u8
+{
+    typedef u8 value_t;
+    static const u32 count = 16;
+    static __m128i set1(u64 v) { return _mm_set1_epi8((char)v); }
+    static __m128i eq(__m128i a, __m128i b) { return _mm_cmpeq_epi8(a, b); }
+    static __m128i gt(__m128i a, __m128i b)
+    {
+        const __m128i sign = _mm_set1_epi8((char)0x80);
+        return _mm_cmpgt_epi8(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+    }
+    static u32 mask(__m128i m) { return _mm_movemask_epi8(m); }
+};
+
+struct lanes_u16
+{
+    typedef u16 value_t;
+    static const u32 count = 8;
+    static __m128i set1(u64 v) { return _mm_set1_epi16((short)v); }
+    static __m128i eq(__m128i a, __m128i b) { return _mm_cmpeq_epi16(a, b); }
+    static __m128i gt(__m128i a, __m128i b)
+    {
+        const __m128i sign = _mm_set1_epi16((short)0x8000);
+        return _mm_cmpgt_epi16(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+    }
+    static u32 mask(__m128i m) { return _mm_movemask_epi8(_mm_packs_epi16(m, _mm_setzero_si128())) & 0xff; }
+};
+
+struct lanes_u32
+{
+    typedef u32 value_t;
+    static const u32 count = 4;
+    static __m128i set1(u64 v) { return _mm_set1_epi32((int)v); }
+    static __m128i eq(__m128i a, __m128i b) { return _mm_cmpeq_epi32(a, b); }
+    static __m128i gt(__m128i a, __m128i b)
+    {
+        const __m128i sign = _mm_set1_epi32((int)0x80000000);
+        return _mm_cmpgt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+    }
+    static u32 mask(__m128i m) { return _mm_movemask_ps(_mm_castsi128_ps(m)); }
+};
+
+// SSE2 has no 64 bit compares, they are built from 32 bit ones.
+// Only the high half of each lane is exact, which is all mask() reads.
+struct lanes_u64
+{
+    typedef u64 value_t;
+    static const u32 count = 2;
+    static __m128i set1(u64 v) { return _mm_set1_epi64x((long long)v); }
+    static __m128i eq(__m128i a, __m128i b)
+    {
+        __m128i e = _mm_cmpeq_epi32(a, b);
+        return _mm_and_si128(e, _mm_shuffle_epi32(e, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+    static __m128i gt(__m128i a, __m128i b)
+    {
+        const __m128i sign = _mm_set1_epi32((int)0x80000000);
+        __m128i g = _mm_cmpgt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+        __m128i e = _mm_cmpeq_epi32(a, b);
+        // high greater, or high equal and low greater
+        return _mm_or_si128(g, _mm_and_si128(e, _mm_shuffle_epi32(g, _MM_SHUFFLE(2, 2, 0, 0))));
+    }
+    static u32 mask(__m128i m) { return _mm_movemask_pd(_mm_castsi128_pd(m)); }
+};
+
+struct lanes_f32
+{
+    typedef f32 value_t;
+    static const u32 count = 4;
+    static __m128i set1(u64 v) { return _mm_set1_epi32((int)v); }
+    static __m128i eq(__m128i a, __m128i b) { return _mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b))); }
+    static __m128i gt(__m128i a, __m128i b) { return _mm_castps_si128(_mm_cmpgt_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b))); }
+    static u32 mask(__m128i m) { return _mm_movemask_ps(_mm_castsi128_ps(m)); }
+};
+
+struct lanes_f64
+{
+    typedef f64 value_t;
+    static const u32 count = 2;
+    static __m128i set1(u64 v) { return _mm_set1_epi64x((long long)v); }
+    static __m128i eq(__m128i a, __m128i b) { return _mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b))); }
+    static __m128i gt(__m128i a, __m128i b) { return _mm_castpd_si128(_mm_cmpgt_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b))); }
+    static u32 mask(__m128i m) { return _mm_movemask_pd(_mm_castsi128_pd(m)); }
+};
+
+template <class L, search_cmp_t C>
+static inline __m128i lane_match(__m128i cur, __m128i prev, __m128i a, __m128i b)
+{
+    switch (C)
+    {
+        case SEARCH_EQ: return L::eq(cur, a);
+        // written so NaN never matches
+        case SEARCH_RANGE: return _mm_and_si128(_mm_or_si128(L::gt(cur, a), L::eq(cur, a)),
+                                                _mm_or_si128(L::gt(b, cur), L::eq(b, cur)));
+        case SEARCH_CHANGED: return _mm_xor_si128(L::eq(cur, prev), _mm_set1_epi32(-1));
+        case SEARCH_UNCHANGED: return L::eq(cur, prev);
+        case SEARCH_INCREASED: return L::gt(cur, prev);
+        case SEARCH_DECREASED: return L::gt(prev, cur);
+        default: return _mm_set1_epi32(-1);
+    }
+}
+
+template <typename T>
+static inline T value_from_bits(u64 bits)
+{
+    T value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+template <typename T>
+static inline bool scalar_match(search_cmp_t cmp, T cur, T prev, T a, T b)
+{
+    switch (cmp)
+    {
+        case SEARCH_EQ: return cur == a;
+        case SEARCH_RANGE: return cur >= a && cur <= b;
+        case SEARCH_CHANGED: return !(cur == prev);
+        case SEARCH_UNCHANGED: return cur == prev;
+        case SEARCH_INCREASED: return cur > prev;
+        case SEARCH_DECREASED: return cur < prev;
+        default: return true;
+    }
+}
+
+/*
+ * @brief Compare every value of a region, set `bits` for the matches
+ *
+ * First scan: `prev` is nullptr and `bits` is overwritten.
+ * Later passes: only words of `bits` with candidates left are read, the
+ * matches are and-ed in and the blocks read are copied to `prev`.
+ *
+ * @returns Number of bits set
+ */
+template <class L, search_cmp_t C>
+static u64 dense_pass(const u8 *cur, u8 *prev, u64 size, const search_filter_t *filter, u64 *bits)
+{
+    typedef typename L::value_t T;
+    const __m128i a = L::set1(filter->a);
+    const __m128i b = L::set1(filter->b);
+    const u64 slots = size / sizeof(T);
+    const u64 full_words = slots / 64;
+    constexpr u64 word_bytes = 64 * sizeof(T);
+    u64 count = 0;
+    for (u64 w = 0; w < full_words; w++)
+    {
+        if (prev && !bits[w])
+        {
+            continue;
+        }
+        const u8 *c = cur + w * word_bytes;
+        u8 *p = prev ? prev + w * word_bytes : nullptr;
+        u64 word = 0;
+        for (u32 k = 0; k < 64 / L::count; k++)
+        {
+            __m128i cv = _mm_loadu_si128((const __m128i *)(c + k * 16));
+            __m128i pv = cv;
+            if (p)
+            {
+                pv = _mm_loadu_si128((const __m128i *)(p + k * 16));
+                _mm_storeu_si128((__m128i *)(p + k * 16), cv);
+            }
+            word |= (u64)L::mask(lane_match<L, C>(cv, pv, a, b)) << (k * L::count);
+        }
+        if (prev)
+        {
+            word &= bits[w];
+        }
+        bits[w] = word;
+        count += __builtin_popcountll(word);
+    }
+    // last partial word
+    if (slots % 64)
+    {
+        u64 word = 0;
+        const T va = value_from_bits<T>(filter->a);
+        const T vb = value_from_bits<T>(filter->b);
+        for (u64 i = full_words * 64; i < slots; i++)
+        {
+            T cv;
+            memcpy(&cv, cur + i * sizeof(T), sizeof(T));
+            T pv = cv;
+            if (prev)
+            {
+                memcpy(&pv, prev + i * sizeof(T), sizeof(T));
+                memcpy(prev + i * sizeof(T), &cv, sizeof(T));
+            }
+            if (scalar_match<T>(C, cv, pv, va, vb))
+            {
+                word |= 1ull << (i % 64);
+            }
+        }
+        if (prev)
+        {
+            word &= bits[full_words];
+        }
+        bits[full_words] = word;
+        count += __builtin_popcountll(word);
+    }
+    return count;
+}
+
+typedef u64 (*dense_pass_t)(const u8 *, u8 *, u64, const search_filter_t *, u64 *);
+
+template <class L>
+static dense_pass_t dense_pass_for(search_cmp_t cmp)
+{
+    switch (cmp)
+    {
+        case SEARCH_EQ: return dense_pass<L, SEARCH_EQ>;
+        case SEARCH_RANGE: return dense_pass<L, SEARCH_RANGE>;
+        case SEARCH_CHANGED: return dense_pass<L, SEARCH_CHANGED>;
+        case SEARCH_UNCHANGED: return dense_pass<L, SEARCH_UNCHANGED>;
+        case SEARCH_INCREASED: return dense_pass<L, SEARCH_INCREASED>;
+        case SEARCH_DECREASED: return dense_pass<L, SEARCH_DECREASED>;
+        default: return dense_pass<L, SEARCH_ANY>;
+    }
+}
+
+static dense_pass_t dense_pass_get(search_type_t type, search_cmp_t cmp)
+{
+    switch (type)
+    {
+        case SEARCH_U8: return dense_pass_for<lanes_u8>(cmp);
+        case SEARCH_U16: return dense_pass_for<lanes_u16>(cmp);
+        case SEARCH_U32: return dense_pass_for<lanes_u32>(cmp);
+        case SEARCH_U64: return dense_pass_for<lanes_u64>(cmp);
+        case SEARCH_F32: return dense_pass_for<lanes_f32>(cmp);
+        default: return dense_pass_for<lanes_f64>(cmp);
+    }
+}
+
+static bool value_match(search_type_t type, search_cmp_t cmp, u64 cur, u64 prev, const search_filter_t *filter)
+{
+    switch (type)
+    {
+        case SEARCH_U8: return scalar_match<u8>(cmp, cur, prev, filter->a, filter->b);
+        case SEARCH_U16: return scalar_match<u16>(cmp, cur, prev, filter->a, filter->b);
+        case SEARCH_U32: return scalar_match<u32>(cmp, cur, prev, filter->a, filter->b);
+        case SEARCH_U64: return scalar_match<u64>(cmp, cur, prev, filter->a, filter->b);
+        case SEARCH_F32:
+            return scalar_match<f32>(cmp, value_from_bits<f32>(cur), value_from_bits<f32>(prev),
+                                     value_from_bits<f32>(filter->a), value_from_bits<f32>(filter->b));
+        default:
+            return scalar_match<f64>(cmp, value_from_bits<f64>(cur), value_from_bits<f64>(prev),
+                                     value_from_bits<f64>(filter->a), value_from_bits<f64>(filter->b));
+    }
+}
+
+static u32 leb128_put(u8 *out, u64 value)
+{
+    u32 n = 0;
+    do
+    {
+        u8 byte = value & 0x7f;
+        value >>= 7;
+        out[n++] = byte | (value ? 0x80 : 0);
+    } while (value);
+    return n;
+}
+
+static u64 leb128_get(const u8 **in)
+{
+    u64 value = 0;
+    u32 shift = 0;
+    u8 byte = 0;
+    do
+    {
+        byte = *(*in)++;
+        value |= (u64)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+// Candidate storage sits in mappings of its own, so the process scan can leave it out.
+// A header in front of the data holds the length of the mapping.
+static constexpr u64 storage_header = 16;
+
+// Live memory is read in chunks of this size, a multiple of 64 values of every type
+static constexpr u64 read_chunk = 0x40000;
+
+// Candidates further apart than this are read with a call each, copying the gap costs more
+static constexpr u64 read_gap = 0x1000;
+
+static void *storage_alloc(u64 size)
+{
+    const u64 length = (size + storage_header + MEM_PAGE_SIZE - 1) & ~(u64)(MEM_PAGE_SIZE - 1);
+    u8 *base = (u8 *)mem_map(length);
+    if (!base)
+    {
+        return nullptr;
+    }
+    *(u64 *)base = length;
+    return base + storage_header;
+}
+
+static void storage_free(void *data)
+{
+    if (data)
+    {
+        u8 *base = (u8 *)data - storage_header;
+        mem_unmap(base, *(u64 *)base);
+    }
+}
+
+/*
+ * @brief Get the lowest storage mapping of the search that overlaps [addr, end)
+ *
+ * @returns false if there is none
+ */
+static bool storage_next(const search_t *search, u64 addr, u64 end, u64 *found_start, u64 *found_end)
+{
+    bool found = false;
+    for (u32 i = 0; i <= search->region_count; i++)
+    {
+        const void *data[3] = {search->region, nullptr, nullptr};
+        if (i < search->region_count)
+        {
+            data[0] = search->region[i].bits;
+            data[1] = search->region[i].values;
+            data[2] = search->region[i].offsets;
+        }
+        for (u32 j = 0; j < 3; j++)
+        {
+            if (!data[j])
+            {
+                continue;
+            }
+            const u8 *base = (const u8 *)data[j] - storage_header;
+            const u64 start = (u64)base;
+            const u64 stop = start + *(const u64 *)base;
+            if (stop > addr && start < end && (!found || start < *found_start))
+            {
+                *found_start = start;
+                *found_end = stop;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+static u64 region_memory(const search_t *search, const search_region_t *region)
+{
+    if (region->offsets)
+    {
+        return region->offsets_size + region->count * search->value_size;
+    }
+    return region->size + ((region->size / search->value_size + 63) / 64) * sizeof(u64);
+}
+
+// sparse storage pays off once a few bytes per candidate beat a bit per value plus the copy
+static bool region_prefers_sparse(const search_t *search, const search_region_t *region)
+{
+    return region->count * (search->value_size + 3) < region->size / 2;
+}
+
+/*
+ * @brief Replace the bitmap and copy of a dense region with offsets and values of its candidates
+ *
+ * @param cur Memory the values are taken from, nullptr to leave them to sparse_gather()
+ */
+static void region_make_sparse(const search_t *search, search_region_t *region, const u8 *cur)
+{
+    const u32 value_size = search->value_size;
+    const u64 words = (region->size / value_size + 63) / 64;
+    u8 *offsets = (u8 *)storage_alloc(region->count * 10 + 1);
+    u8 *values = (u8 *)storage_alloc(region->count * value_size + 1);
+    if (!offsets || !values)
+    {
+        // stays dense
+        storage_free(offsets);
+        storage_free(values);
+        return;
+    }
+    u64 offsets_size = 0;
+    u64 n = 0;
+    u64 last = 0;
+    for (u64 w = 0; w < words; w++)
+    {
+        u64 word = region->bits[w];
+        while (word)
+        {
+            u64 index = w * 64 + __builtin_ctzll(word);
+            word &= word - 1;
+            offsets_size += leb128_put(offsets + offsets_size, index - last);
+            if (cur)
+            {
+                memcpy(values + n * value_size, cur + index * value_size, value_size);
+            }
+            last = index;
+            n++;
+        }
+    }
+    storage_free(region->bits);
+    storage_free(region->values);
+    region->bits = nullptr;
+    u8 *shrunk = (u8 *)storage_alloc(offsets_size + 1);
+    if (shrunk)
+    {
+        memcpy(shrunk, offsets, offsets_size);
+        storage_free(offsets);
+        offsets = shrunk;
+    }
+    region->offsets = offsets;
+    region->offsets_size = offsets_size;
+    region->values = values;
+}
+
+static void region_free(search_region_t *region)
+{
+    storage_free(region->bits);
+    storage_free(region->values);
+    storage_free(region->offsets);
+    memset(region, 0, sizeof(*region));
+}
+
+/*
+ * @brief Narrow the candidates of a dense region, reading it a chunk at a time
+ *
+ * Chunks without candidates left are not read.
+ *
+ * @returns false if the region could not be read
+ */
+static bool dense_next(const search_t *search, search_region_t *region, dense_pass_t pass, const search_filter_t *filter,
+                       u8 *chunk)
+{
+    const u64 word_bytes = 64 * search->value_size;
+    u64 count = 0;
+    for (u64 offset = 0; offset < region->size; offset += read_chunk)
+    {
+        const u64 size = (region->size - offset < read_chunk) ? region->size - offset : read_chunk;
+        u64 *bits = region->bits + offset / word_bytes;
+        const u64 words = (size + word_bytes - 1) / word_bytes;
+        u64 w = 0;
+        while (w < words && !bits[w])
+        {
+            w++;
+        }
+        if (w == words)
+        {
+            continue;
+        }
+        if (!mem_read(region->addr + offset, chunk, size))
+        {
+            return false;
+        }
+        count += pass(chunk, region->values + offset, size, filter, bits);
+    }
+    region->count = count;
+    return true;
+}
+
+/*
+ * @brief Read the current value of every candidate of a sparse region
+ *
+ * Each read runs from a candidate to the last one after it that is within
+ * read_gap of the one before, and at most read_chunk long.
+ *
+ * @param out    count * value size bytes
+ * @param chunk  read_chunk bytes
+ * @returns      false if the region could not be read
+ */
+static bool sparse_gather(const search_t *search, const search_region_t *region, u8 *out, u8 *chunk)
+{
+    const u32 value_size = search->value_size;
+    const u8 *in = region->offsets;
+    u64 index = 0;
+    u64 chunk_start = 0;
+    u64 chunk_end = 0;
+    for (u64 i = 0; i < region->count; i++)
+    {
+        index += leb128_get(&in);
+        const u64 offset = index * value_size;
+        if (offset + value_size > chunk_end)
+        {
+            const u8 *ahead = in;
+            u64 next = index;
+            u64 last = offset;
+            for (u64 j = i + 1; j < region->count; j++)
+            {
+                next += leb128_get(&ahead);
+                if (next * value_size - last > read_gap || next * value_size + value_size - offset > read_chunk)
+                {
+                    break;
+                }
+                last = next * value_size;
+            }
+            chunk_start = offset;
+            chunk_end = last + value_size;
+            if (!mem_read(region->addr + chunk_start, chunk, chunk_end - chunk_start))
+            {
+                return false;
+            }
+        }
+        memcpy(out + i * value_size, chunk + offset - chunk_start, value_size);
+    }
+    return true;
+}
+
+/*
+ * @brief Narrow the candidates of a sparse region, offsets and values are rewritten in place
+ *
+ * A merged delta never takes more bytes than the deltas it replaces.
+ *
+ * @returns false if the region could not be read
+ */
+static bool sparse_pass(const search_t *search, search_region_t *region, const search_filter_t *filter, u8 *chunk)
+{
+    const u32 value_size = search->value_size;
+    u8 *current = (u8 *)malloc(region->count * value_size);
+    if (!sparse_gather(search, region, current, chunk))
+    {
+        free(current);
+        return false;
+    }
+    const u8 *in = region->offsets;
+    u8 *out = region->offsets;
+    u64 index = 0;
+    u64 last_kept = 0;
+    u64 kept = 0;
+    for (u64 i = 0; i < region->count; i++)
+    {
+        index += leb128_get(&in);
+        u64 cur = 0;
+        u64 prev = 0;
+        memcpy(&cur, current + i * value_size, value_size);
+        memcpy(&prev, region->values + i * value_size, value_size);
+        if (!value_match(search->type, filter->cmp, cur, prev, filter))
+        {
+            continue;
+        }
+        out += leb128_put(out, index - last_kept);
+        memcpy(region->values + kept * value_size, &cur, value_size);
+        last_kept = index;
+        kept++;
+    }
+    free(current);
+    region->offsets_size = out - region->offsets;
+    region->count = kept;
+    return true;
+}
+
+bool search_parse_type(const char *name, search_type_t *type)
+{
+    static const char *names[] = {"u8", "u16", "u32", "u64", "f32", "f64"};
+    for (u32 i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        if (!strcasecmp(name, names[i]))
+        {
+            *type = (search_type_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * @brief Parse a value of the search type, integers may be hex with a 0x prefix
+ */
+bool search_parse_value(search_type_t type, const char *str, u64 *value)
+{
+    char *end = nullptr;
+    if (type == SEARCH_F32 || type == SEARCH_F64)
+    {
+        f64 parsed = strtod(str, &end);
+        if (end == str || *end)
+        {
+            return false;
+        }
+        if (type == SEARCH_F32)
+        {
+            f32 narrow = (f32)parsed;
+            u32 bits = 0;
+            memcpy(&bits, &narrow, sizeof(bits));
+            *value = bits;
+        }
+        else
+        {
+            memcpy(value, &parsed, sizeof(*value));
+        }
+        return true;
+    }
+    if (str[0] == '-')
+    {
+        return false;
+    }
+    u64 parsed = strtoull(str, &end, 0);
+    if (end == str || *end)
+    {
+        return false;
+    }
+    const u32 bits = 8u << (type == SEARCH_U8 ? 0 : type == SEARCH_U16 ? 1 : type == SEARCH_U32 ? 2 : 3);
+    if (bits < 64 && parsed >> bits)
+    {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
+void search_format_value(search_type_t type, u64 value, char *out, u32 out_size)
+{
+    switch (type)
+    {
+        case SEARCH_F32: snprintf(out, out_size, "%g", value_from_bits<f32>(value)); break;
+        case SEARCH_F64: snprintf(out, out_size, "%g", value_from_bits<f64>(value)); break;
+        default: snprintf(out, out_size, "%lu (0x%lx)", value, value); break;
+    }
+}
+
+static u32 search_type_size(search_type_t type)
+{
+    switch (type)
+    {
+        case SEARCH_U8: return 1;
+        case SEARCH_U16: return 2;
+        case SEARCH_U32:
+        case SEARCH_F32: return 4;
+        default: return 8;
+    }
+}
+
+// 0 if the address can no longer be read
+u64 search_read_value(search_type_t type, u64 addr)
+{
+    u64 value = 0;
+    mem_read(addr, &value, search_type_size(type));
+    return value;
+}
+
+void search_begin(search_t *search, search_type_t type)
+{
+    u64 memory_limit = search->memory_limit;
+    memset(search, 0, sizeof(*search));
+    search->type = type;
+    search->value_size = search_type_size(type);
+    search->memory_limit = memory_limit;
+}
+
+/*
+ * @brief First scan of one region
+ *
+ * The region is trimmed to whole aligned values and read a chunk at a
+ * time into a scratch mapping, the scan runs on the chunks. A region that
+ * stays dense is then read again into the copy it keeps, a sparse one only
+ * around its candidates. Regions that can't be read, are left without
+ * candidates or would go over the memory limit are not kept.
+ *
+ * @param filter SEARCH_ANY, SEARCH_EQ or SEARCH_RANGE
+ * @returns      Candidates found in the region
+ */
+u64 search_first(search_t *search, u64 addr, u64 size, const search_filter_t *filter)
+{
+    const u32 value_size = search->value_size;
+    u64 start = (addr + value_size - 1) & ~(u64)(value_size - 1);
+    if (start >= addr + size)
+    {
+        return 0;
+    }
+    size = ((addr + size - start) / value_size) * value_size;
+    if (!size)
+    {
+        return 0;
+    }
+    search_region_t region = {};
+    region.addr = start;
+    region.size = size;
+    const u64 slots = size / value_size;
+    const u64 words = (slots + 63) / 64;
+    // storage, the scan never reads its own scratch
+    u8 *chunk = (u8 *)storage_alloc(read_chunk);
+    region.bits = (u64 *)storage_alloc(words * sizeof(u64));
+    const bool mapped = chunk && region.bits;
+    bool read = mapped;
+    if (read && filter->cmp == SEARCH_ANY)
+    {
+        memset(region.bits, 0xff, words * sizeof(u64));
+        if (slots % 64)
+        {
+            region.bits[words - 1] = (1ull << (slots % 64)) - 1;
+        }
+        region.count = slots;
+    }
+    else if (read)
+    {
+        const dense_pass_t pass = dense_pass_get(search->type, filter->cmp);
+        for (u64 offset = 0; read && offset < size; offset += read_chunk)
+        {
+            const u64 chunk_size = (size - offset < read_chunk) ? size - offset : read_chunk;
+            read = mem_read(start + offset, chunk, chunk_size);
+            if (read)
+            {
+                region.count += pass(chunk, nullptr, chunk_size, filter, region.bits + offset / (64 * value_size));
+            }
+        }
+    }
+    if (read && region.count && region_prefers_sparse(search, &region))
+    {
+        region_make_sparse(search, &region, nullptr);
+        read = !region.offsets || sparse_gather(search, &region, region.values, chunk);
+    }
+    storage_free(chunk);
+    if (!read || !region.count)
+    {
+        if (!read)
+        {
+            final_printf("Search: 0x%lx-0x%lx skipped, %s\n", start, start + size, mapped ? "not readable" : "out of memory");
+        }
+        region_free(&region);
+        return 0;
+    }
+    if (search->memory_limit && search->memory + region_memory(search, &region) > search->memory_limit)
+    {
+        final_printf("Search: 0x%lx-0x%lx skipped, memory limit of %lu bytes reached\n", start, start + size, search->memory_limit);
+        region_free(&region);
+        return 0;
+    }
+    if (!region.offsets)
+    {
+        region.values = (u8 *)storage_alloc(size);
+        if (!region.values || !mem_read(start, region.values, size))
+        {
+            final_printf("Search: 0x%lx-0x%lx skipped, %s\n", start, start + size, region.values ? "not readable" : "out of memory");
+            region_free(&region);
+            return 0;
+        }
+    }
+    if ((search->region_count % 64) == 0)
+    {
+        search_region_t *grown = (search_region_t *)storage_alloc((64 + search->region_count) * sizeof(search_region_t));
+        if (!grown)
+        {
+            final_printf("Search: 0x%lx-0x%lx skipped, out of memory\n", start, start + size);
+            region_free(&region);
+            return 0;
+        }
+        if (search->region)
+        {
+            memcpy(grown, search->region, search->region_count * sizeof(search_region_t));
+        }
+        storage_free(search->region);
+        search->region = grown;
+    }
+    search->region[search->region_count++] = region;
+    search->count += region.count;
+    search->memory += region_memory(search, &region);
+    return region.count;
+}
+
+/*
+ * @brief First scan of every writable mapping of the process
+ *
+ * Executable mappings are left out, values live in data. So are the
+ * storage mappings of the search itself, the parts of a mapping around
+ * them are scanned as regions of their own. Storage mapped while the scan
+ * runs lands in address space that has no mapping yet, so it is met and
+ * left out further on.
+ */
+u64 search_first_process(search_t *search, const search_filter_t *filter)
+{
+    u64 addr = 0;
+    u64 start = 0;
+    u64 end = 0;
+    s32 prot = 0;
+    u32 regions = 0;
+    u64 bytes = 0;
+    u64 own = 0;
+    search->revalidate = true;
+    while (mem_next_region(addr, &start, &end, &prot) && end > addr)
+    {
+        addr = end;
+        if ((prot & (MEM_PROT_READ | MEM_PROT_WRITE)) != (MEM_PROT_READ | MEM_PROT_WRITE) || (prot & MEM_PROT_EXEC))
+        {
+            continue;
+        }
+        u64 pos = start;
+        while (pos < end)
+        {
+            u64 skip_start = end;
+            u64 skip_end = end;
+            if (storage_next(search, pos, end, &skip_start, &skip_end))
+            {
+                own += ((skip_end < end) ? skip_end : end) - ((skip_start > pos) ? skip_start : pos);
+            }
+            if (skip_start > pos)
+            {
+                search_first(search, pos, skip_start - pos, filter);
+                regions++;
+                bytes += skip_start - pos;
+            }
+            pos = skip_end;
+        }
+    }
+    search->passes = 1;
+    final_printf("Search: %lu candidates in %u regions, %lu bytes read, %lu bytes of its own left out, %lu bytes held\n",
+                 search->count, regions, bytes, own, search->memory);
+    return search->count;
+}
+
+/*
+ * @brief Narrow the candidates with another pass
+ *
+ * Each candidate is compared with its value from the previous pass, or
+ * with the filter values for SEARCH_EQ and SEARCH_RANGE. Dense regions
+ * switch to sparse storage once few candidates are left. Regions that
+ * can no longer be read are dropped.
+ *
+ * @returns Candidates left
+ */
+u64 search_next(search_t *search, const search_filter_t *filter)
+{
+    if (filter->cmp == SEARCH_ANY)
+    {
+        return search->count;
+    }
+    const dense_pass_t pass = dense_pass_get(search->type, filter->cmp);
+    u8 *chunk = (u8 *)malloc(read_chunk);
+    u32 kept = 0;
+    search->count = 0;
+    search->memory = 0;
+    for (u32 i = 0; i < search->region_count; i++)
+    {
+        search_region_t *region = &search->region[i];
+        u64 start = 0;
+        u64 end = 0;
+        s32 prot = 0;
+        if (search->revalidate &&
+            (!mem_query_protection(region->addr, &start, &end, &prot) ||
+             end < region->addr + region->size || !(prot & MEM_PROT_READ)))
+        {
+            final_printf("Search: 0x%lx-0x%lx is no longer mapped\n", region->addr, region->addr + region->size);
+            region_free(region);
+            continue;
+        }
+        if (!(region->offsets ? sparse_pass(search, region, filter, chunk) : dense_next(search, region, pass, filter, chunk)))
+        {
+            final_printf("Search: 0x%lx-0x%lx can no longer be read\n", region->addr, region->addr + region->size);
+            region_free(region);
+            continue;
+        }
+        if (!region->offsets && region->count && region_prefers_sparse(search, region))
+        {
+            region_make_sparse(search, region, region->values);
+        }
+        if (!region->count)
+        {
+            region_free(region);
+            continue;
+        }
+        search->count += region->count;
+        search->memory += region_memory(search, region);
+        search->region[kept++] = *region;
+    }
+    free(chunk);
+    search->region_count = kept;
+    search->passes++;
+    return search->count;
+}
+
+/*
+ * @brief Addresses of the first `max` candidates, in address order within each region
+ *
+ * @returns Number of addresses written
+ */
+u32 search_results(const search_t *search, u64 *addr, u32 max)
+{
+    u32 n = 0;
+    for (u32 i = 0; i < search->region_count && n < max; i++)
+    {
+        const search_region_t *region = &search->region[i];
+        if (region->offsets)
+        {
+            const u8 *in = region->offsets;
+            u64 index = 0;
+            for (u64 j = 0; j < region->count && n < max; j++)
+            {
+                index += leb128_get(&in);
+                addr[n++] = region->addr + index * search->value_size;
+            }
+            continue;
+        }
+        const u64 words = (region->size / search->value_size + 63) / 64;
+        for (u64 w = 0; w < words && n < max; w++)
+        {
+            u64 word = region->bits[w];
+            while (word && n < max)
+            {
+                addr[n++] = region->addr + (w * 64 + __builtin_ctzll(word)) * search->value_size;
+                word &= word - 1;
+            }
+        }
+    }
+    return n;
+}
+
+void search_free(search_t *search)
+{
+    for (u32 i = 0; i < search->region_count; i++)
+    {
+        region_free(&search->region[i]);
+    }
+    storage_free(search->region);
+    search->region = nullptr;
+    search->region_count = 0;
+    search->count = 0;
+    search->memory = 0;
+    search->passes = 0;
+}
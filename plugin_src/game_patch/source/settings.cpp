@@ -0,0 +1,221 @@
+#include <dirent.h>
+#include "settings.h"
+#include "utils.h"
+
+static s32 settings_find(const settings_t *settings, u64 hash)
+{
+    s32 lo = 0;
+    s32 hi = (s32)settings->size - 1;
+    while (lo <= hi)
+    {
+        s32 mid = (lo + hi) / 2;
+        if (settings->entry[mid].hash == hash)
+        {
+            return mid;
+        }
+        if (settings->entry[mid].hash < hash)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    return -(lo + 1);
+}
+
+static settings_entry_t *settings_set(settings_t *settings, u64 hash)
+{
+    s32 index = settings_find(settings, hash);
+    if (index >= 0)
+    {
+        return &settings->entry[index];
+    }
+    index = -index - 1;
+    if ((settings->size % 64) == 0)
+    {
+        settings->entry = (settings_entry_t *)realloc(settings->entry, (64 + settings->size) * sizeof(settings_entry_t));
+    }
+    memmove(&settings->entry[index + 1], &settings->entry[index], (settings->size - index) * sizeof(settings_entry_t));
+    settings_entry_t *entry = &settings->entry[index];
+    memset(entry, 0, sizeof(*entry));
+    entry->hash = hash;
+    entry->mtime_sec = -1; // never matches a file
+    settings->size++;
+    return entry;
+}
+
+/*
+ * @brief Bring one entry up to date with its settings file
+ *
+ * One sceKernelStat() of the file, which is only read when its mtime differs
+ * from the one the entry was read with.
+ *
+ * @param create Write a disabled settings file if it does not exist
+ * @returns      true if the patch is enabled
+ */
+static bool settings_refresh(settings_t *settings, settings_entry_t *entry, const char *settings_path, bool create)
+{
+    OrbisKernelStat stat;
+    const bool exists = !sceKernelStat(settings_path, &stat);
+    const s64 mtime_sec = exists ? stat.st_mtim.tv_sec : 0;
+    const u32 mtime_nsec = exists ? stat.st_mtim.tv_nsec : 0;
+    settings->files_checked++;
+    if (exists && entry->mtime_sec == mtime_sec && entry->mtime_nsec == mtime_nsec)
+    {
+        return (entry->flags & SETTINGS_FLAG_ENABLED) != 0;
+    }
+
+    bool enabled = false;
+    if (exists)
+    {
+        char *buffer = nullptr;
+        u64 size = 0;
+        debug_printf("Settings path: %s\n", settings_path);
+        enabled = !Read_File(settings_path, &buffer, &size, 0) && buffer && buffer[0] == '1';
+        free(buffer);
+        settings->files_read++;
+    }
+    else if (create)
+    {
+        debug_printf("file %s not found, initializing false.\n", settings_path);
+        u8 false_data[] = {'0', '\n'};
+        Write_File(settings_path, false_data, sizeof(false_data));
+    }
+    // a new file keeps mtime 0 in the index, so it is read once on the next boot
+    entry->flags = enabled ? SETTINGS_FLAG_ENABLED : 0;
+    entry->mtime_sec = mtime_sec;
+    entry->mtime_nsec = mtime_nsec;
+    settings->dirty = true;
+    return enabled;
+}
+
+/*
+ * @brief Whether the patch with settings `hash` is enabled
+ *
+ * Indexed entries are answered without a file access while the settings
+ * folder is unchanged. Otherwise the file is checked, a missing one is
+ * written as disabled.
+ */
+bool settings_enabled(settings_t *settings, u64 hash, const char *settings_dir)
+{
+    const s32 index = settings_find(settings, hash);
+    if (index >= 0 && settings->dir_current)
+    {
+        return (settings->entry[index].flags & SETTINGS_FLAG_ENABLED) != 0;
+    }
+    char settings_path[MAX_PATH_];
+    snprintf(settings_path, sizeof(settings_path), "%s/0x%016lx.txt", settings_dir, hash);
+    return settings_refresh(settings, settings_set(settings, hash), settings_path, true);
+}
+
+// Every 0x%016lx.txt of the settings folder into the index
+static void settings_import(settings_t *settings, const char *settings_dir)
+{
+    DIR *dir = opendir(settings_dir);
+    if (!dir)
+    {
+        final_printf("Could not open %s\n", settings_dir);
+        return;
+    }
+    struct dirent *ent = nullptr;
+    while ((ent = readdir(dir)) != NULL)
+    {
+        if (strlen(ent->d_name) != 22 || strncmp(ent->d_name, "0x", 2) || strcmp(ent->d_name + 18, ".txt"))
+        {
+            continue;
+        }
+        char settings_path[MAX_PATH_];
+        snprintf(settings_path, sizeof(settings_path), "%s/%s", settings_dir, ent->d_name);
+        settings_refresh(settings, settings_set(settings, strtoull(ent->d_name, NULL, 16)), settings_path, false);
+    }
+    closedir(dir);
+    final_printf("Imported %u patch settings from %s\n", settings->size, settings_dir);
+}
+
+static bool settings_dir_mtime(const char *settings_dir, s64 *mtime_sec, u32 *mtime_nsec)
+{
+    OrbisKernelStat stat;
+    if (sceKernelStat(settings_dir, &stat))
+    {
+        return false;
+    }
+    *mtime_sec = stat.st_mtim.tv_sec;
+    *mtime_nsec = stat.st_mtim.tv_nsec;
+    return true;
+}
+
+/*
+ * @brief Load the settings index, import the per patch files if there is none
+ */
+void settings_load(settings_t *settings, const char *index_path, const char *settings_dir)
+{
+    char *buffer = nullptr;
+    u64 size = 0;
+    settings->entry = nullptr;
+    settings->size = 0;
+    settings->files_read = 0;
+    settings->files_checked = 0;
+    settings->dir_current = false;
+    settings->dirty = false;
+    if (!Read_File(index_path, &buffer, &size, 0) && buffer)
+    {
+        const settings_header_t *header = (const settings_header_t *)buffer;
+        if (size >= sizeof(*header) &&
+            header->magic == SETTINGS_INDEX_MAGIC &&
+            header->version == SETTINGS_INDEX_VERSION &&
+            size >= sizeof(*header) + header->count * sizeof(settings_entry_t))
+        {
+            // reserve the same way settings_set() grows the table
+            u32 capacity = (header->count + 63) / 64 * 64;
+            settings->size = header->count;
+            settings->entry = (settings_entry_t *)malloc(capacity * sizeof(settings_entry_t));
+            memcpy(settings->entry, buffer + sizeof(*header), settings->size * sizeof(settings_entry_t));
+            s64 mtime_sec = 0;
+            u32 mtime_nsec = 0;
+            settings->dir_current = settings_dir_mtime(settings_dir, &mtime_sec, &mtime_nsec) &&
+                                    header->dir_mtime_sec == mtime_sec && header->dir_mtime_nsec == mtime_nsec;
+            // a changed folder is recorded on save even if no entry changes
+            settings->dirty = !settings->dir_current;
+            free(buffer);
+            return;
+        }
+        final_printf("Settings index %s is invalid, rebuilding\n", index_path);
+    }
+    free(buffer);
+    settings_import(settings, settings_dir);
+}
+
+/*
+ * @brief Write the index if anything changed, with the folder mtime after the files written for it
+ */
+void settings_save(settings_t *settings, const char *index_path, const char *settings_dir)
+{
+    if (!settings->dirty)
+    {
+        return;
+    }
+    s64 dir_mtime_sec = -1; // never matches the folder
+    u32 dir_mtime_nsec = 0;
+    settings_dir_mtime(settings_dir, &dir_mtime_sec, &dir_mtime_nsec);
+    u64 size = sizeof(settings_header_t) + settings->size * sizeof(settings_entry_t);
+    u8 *buffer = (u8 *)malloc(size);
+    settings_header_t *header = (settings_header_t *)buffer;
+    header->magic = SETTINGS_INDEX_MAGIC;
+    header->version = SETTINGS_INDEX_VERSION;
+    header->count = settings->size;
+    header->dir_mtime_nsec = dir_mtime_nsec;
+    header->dir_mtime_sec = dir_mtime_sec;
+    memcpy(buffer + sizeof(*header), settings->entry, settings->size * sizeof(settings_entry_t));
+    Write_File(index_path, buffer, size);
+    free(buffer);
+    settings->dirty = false;
+}
+
+void settings_free(settings_t *settings)
+{
+    free(settings->entry);
+    settings->entry = nullptr;
+    settings->size = 0;
+}
@@ -0,0 +1,34 @@
+#include "thread.h"
+
+/*
+ * @brief Start a joinable thread
+ *
+ * @param thread Output handle
+ * @param entry  Thread function
+ * @param arg    Argument of `entry`
+ * @param name   Thread name, ignored on Linux
+ * @returns      false if the thread could not be created
+ */
+bool thread_start(thread_t *thread, void *(*entry)(void *), void *arg, const char *name)
+{
+#if defined(__linux__)
+    s32 ret = pthread_create(thread, NULL, entry, arg);
+#else
+    s32 ret = scePthreadCreate(thread, NULL, entry, arg, name);
+#endif
+    if (ret)
+    {
+        final_printf("Could not create thread %s: 0x%08x\n", name, ret);
+        return false;
+    }
+    return true;
+}
+
+void thread_join(thread_t thread)
+{
+#if defined(__linux__)
+    pthread_join(thread, NULL);
+#else
+    scePthreadJoin(thread, NULL);
+#endif
+}
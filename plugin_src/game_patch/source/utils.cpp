@@ -62,7 +62,7 @@ term:
 s32 Write_File(const char *input_file, unsigned char *file_data, u64 filesize) {
     s32 fd = 0;
     s64 size_written = 0;
-    fd = sceKernelOpen(input_file, 0x200 | 0x002, 0777);
+    fd = sceKernelOpen(input_file, 0x200 | 0x400 | 0x002, 0777); // O_CREAT | O_TRUNC | O_RDWR
     if (fd < 0) {
         debug_printf("Failed to make file \"%s\"\n", input_file);
         return 0;
@@ -294,6 +294,8 @@ s32 attr_module_hidden module_start(s64 argc, const void* args) {
         final_printf("Config parser failed to parse config: %s\n", PLUGIN_CONFIG_PATH);
         return -1;
     }
+    // load_config() looks up every option by name
+    ini_table_build_index(config);
 
     final_printf("Section is TitleID [%s]\n", procInfo.titleid);
 
@@ -13,7 +13,7 @@
 #include <orbis/libkernel.h>
 
 #include "plugin_common.h"
-#include "config.h"
+#include "ini.h"
 
 #define PLUGIN_CONFIG_PATH GOLDHEN_PATH "/plugins.ini"
 #define PLUGIN_PATH GOLDHEN_PATH "/plugins"
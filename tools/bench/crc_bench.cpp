@@ -0,0 +1,220 @@
+// CRC bench: checks crc32c() against the RFC 3720 vectors and a bitwise
+// reference, split and unaligned, also from several threads at once, then
+// times it against a byte-at-a-time table on module sized buffers.
+// Usage: crc_bench [buffer MB]
+
+#include <time.h>
+#include "crc32c.h"
+#include "thread.h"
+
+#define CHECK_CASES 3000
+#define THREAD_COUNT 4
+#define THREAD_ROUNDS 200
+#define BENCH_BYTES (256 << 20)
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static u64 g_rng = 88172645463325252ull;
+
+static u32 rng_next(void)
+{
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return (u32)(g_rng >> 32);
+}
+
+// One bit at a time
+static u32 reference_crc32c(u32 crc, const u8 *data, u64 size)
+{
+    crc = ~crc;
+    for (u64 i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+        for (u32 j = 0; j < 8; j++)
+        {
+            crc = (crc >> 1) ^ (0x82f63b78 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static u32 g_table[256];
+
+// One byte at a time through a table, the usual software CRC
+static u32 table_crc32c(u32 crc, const u8 *data, u64 size)
+{
+    crc = ~crc;
+    for (u64 i = 0; i < size; i++)
+    {
+        crc = g_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// RFC 3720 B.4 and the usual check value
+static u32 check_vectors(void)
+{
+    u8 data[32];
+    u32 failed = 0;
+    memset(data, 0, sizeof(data));
+    failed += crc32c(0, data, sizeof(data)) != 0x8a9136aa;
+    memset(data, 0xff, sizeof(data));
+    failed += crc32c(0, data, sizeof(data)) != 0x62a8ab43;
+    for (u32 i = 0; i < sizeof(data); i++)
+    {
+        data[i] = i;
+    }
+    failed += crc32c(0, data, sizeof(data)) != 0x46dd794e;
+    for (u32 i = 0; i < sizeof(data); i++)
+    {
+        data[i] = 31 - i;
+    }
+    failed += crc32c(0, data, sizeof(data)) != 0x113fdb5c;
+    failed += crc32c(0, "123456789", 9) != 0xe3069283;
+    failed += crc32c(0, data, 0) != 0;
+    printf("vectors: %u of 6 differ\n", failed);
+    return failed;
+}
+
+/*
+ * @brief Random buffers against the bitwise reference
+ *
+ * Sizes reach past three CRC32C_BLOCK streams, starts are unaligned and
+ * each buffer is also added in two calls, split at a random point.
+ */
+static u32 check_random(void)
+{
+    const u32 max_size = 100000;
+    u8 *buffer = (u8 *)malloc(max_size + 8);
+    u32 failed = 0;
+    for (u32 i = 0; i < CHECK_CASES; i++)
+    {
+        const u32 size = i % 4 ? rng_next() % 256 : rng_next() % max_size;
+        const u8 *data = buffer + rng_next() % 8;
+        for (u32 j = 0; j < size; j++)
+        {
+            ((u8 *)data)[j] = rng_next() & 0xff;
+        }
+        const u32 seed = i % 3 ? 0 : rng_next();
+        const u32 expected = reference_crc32c(seed, data, size);
+        const u32 split = size ? rng_next() % size : 0;
+        if ((crc32c(seed, data, size) != expected || crc32c(crc32c(seed, data, split), data + split, size - split) != expected) &&
+            failed++ < 3)
+        {
+            fprintf(stderr, "%u bytes at +%lu differ\n", size, (u64)data - (u64)buffer);
+        }
+    }
+    free(buffer);
+    printf("random: %u of %u buffers differ from the bitwise CRC\n", failed, CHECK_CASES);
+    return failed;
+}
+
+struct thread_job_t
+{
+    const u8 *data;
+    u64 size;
+    u32 expected;
+    u32 failed;
+};
+
+static void *crc_thread(void *arg)
+{
+    thread_job_t *job = (thread_job_t *)arg;
+    for (u32 r = 0; r < THREAD_ROUNDS; r++)
+    {
+        job->failed += crc32c(0, job->data, job->size) != job->expected;
+    }
+    return NULL;
+}
+
+// The same buffer from THREAD_COUNT threads at once, as parallel scan workers do
+static u32 check_threads(void)
+{
+    const u64 size = 3 * 8192 * 4 + 123;
+    u8 *buffer = (u8 *)malloc(size);
+    for (u64 i = 0; i < size; i++)
+    {
+        buffer[i] = rng_next() & 0xff;
+    }
+    const u32 expected = reference_crc32c(0, buffer, size);
+    thread_t threads[THREAD_COUNT];
+    thread_job_t jobs[THREAD_COUNT];
+    u32 started = 0;
+    for (u32 i = 0; i < THREAD_COUNT; i++)
+    {
+        jobs[i] = {buffer, size, expected, 0};
+        if (!thread_start(&threads[i], crc_thread, &jobs[i], "crc_bench"))
+        {
+            break;
+        }
+        started++;
+    }
+    u32 failed = started != THREAD_COUNT;
+    for (u32 i = 0; i < started; i++)
+    {
+        thread_join(threads[i]);
+        failed += jobs[i].failed;
+    }
+    free(buffer);
+    printf("threads: %u of %u CRCs on %u threads differ\n", failed, THREAD_COUNT * THREAD_ROUNDS, started);
+    return failed;
+}
+
+static u32 bench(u64 size)
+{
+    u8 *buffer = (u8 *)malloc(size);
+    for (u64 i = 0; i < size; i++)
+    {
+        buffer[i] = rng_next() & 0xff;
+    }
+    const u32 rounds = BENCH_BYTES / size + 1;
+    u32 crc = 0;
+    double start = now_sec();
+    for (u32 r = 0; r < rounds; r++)
+    {
+        crc = crc32c(crc, buffer, size);
+    }
+    double time = now_sec() - start;
+    u32 table_crc = 0;
+    start = now_sec();
+    for (u32 r = 0; r < rounds; r++)
+    {
+        table_crc = table_crc32c(table_crc, buffer, size);
+    }
+    double table_time = now_sec() - start;
+    // Each round is seeded with the last, so both chains must end equal
+    const bool differ = crc != table_crc;
+    printf("%lu KB: crc32c %.2f GB/s, table %.2f GB/s%s\n", size >> 10, (double)rounds * size / time / 1e9,
+           (double)rounds * size / table_time / 1e9, differ ? ", results differ" : "");
+    free(buffer);
+    return differ;
+}
+
+int main(int argc, char **argv)
+{
+    for (u32 i = 0; i < 256; i++)
+    {
+        u32 c = i;
+        for (u32 j = 0; j < 8; j++)
+        {
+            c = (c >> 1) ^ (0x82f63b78 & (0 - (c & 1)));
+        }
+        g_table[i] = c;
+    }
+    u32 failed = check_vectors() + check_random() + check_threads();
+    if (argc > 1)
+    {
+        failed += bench(strtoull(argv[1], NULL, 10) << 20);
+    }
+    else
+    {
+        failed += bench(4 << 10) + bench(64 << 10) + bench(16 << 20);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,344 @@
+// Ghp bench: compiles generated patch xml files on several threads at once,
+// valid and broken ones mixed, and checks every result against a compile of
+// the same file on one thread. Then times the SAX compile of multi-megabyte
+// files against the mxml DOM walk it replaced, with the peak heap of each,
+// and the load of the compiled file.
+// Usage: ghp_bench [xml MB]
+
+#include <malloc.h>
+#include <mxml.h>
+#include <time.h>
+#include "buffer.h"
+#include "ghp.h"
+#include "thread.h"
+#include "utils.h"
+
+#define THREAD_XMLS 24
+#define THREAD_COUNT 4
+#define THREAD_ROUNDS 20
+#define BENCH_BYTES (32 << 20)
+#define GHP_PATH "/tmp/ghp_bench.ghp"
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Heap in use, malloc() is replaced instead of wrapped so allocations made inside a shared libmxml are counted too
+static u64 g_heap_live;
+static u64 g_heap_peak;
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static void *heap_count(void *ptr)
+{
+    if (ptr)
+    {
+        g_heap_live += malloc_usable_size(ptr);
+        g_heap_peak = g_heap_live > g_heap_peak ? g_heap_live : g_heap_peak;
+    }
+    return ptr;
+}
+
+extern "C" void *malloc(size_t size)
+{
+    return heap_count(__libc_malloc(size));
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    return heap_count(__libc_calloc(count, size));
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    g_heap_live -= ptr ? malloc_usable_size(ptr) : 0;
+    return heap_count(__libc_realloc(ptr, size));
+}
+
+extern "C" void free(void *ptr)
+{
+    g_heap_live -= ptr ? malloc_usable_size(ptr) : 0;
+    __libc_free(ptr);
+}
+
+static u64 g_rng = 88172645463325252ull;
+
+static u32 rng_next(void)
+{
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return (u32)(g_rng >> 32);
+}
+
+/*
+ * @brief A patch xml as the community files write them
+ *
+ * `elfs` executables with `entries` Metadata blocks of `lines` lines in
+ * total, spread over the executables in turn. Broken files lose the closing
+ * tag of their last Metadata.
+ */
+static char *make_xml(u32 entries, u32 lines, u32 elfs, bool broken)
+{
+    static const char *types[] = {"bytes", "byte", "bytes32", "float32", "utf8", "mask"};
+    byte_buffer_t xml = {};
+    char text[512];
+    u32 len = snprintf(text, sizeof(text), "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<Patch>\n");
+    buffer_append(&xml, text, len);
+    for (u32 i = 0; i < entries; i++)
+    {
+        len = snprintf(text, sizeof(text),
+                       "    <Metadata Title=\"Bench Title\" Name=\"Patch %u\" Note=\"Generated\" Author=\"bench\"\n"
+                       "              PatchVer=\"1.0\" AppVer=\"01.%02u\" AppElf=\"eboot%u.bin\">\n"
+                       "        <PatchList>\n",
+                       i, i % elfs, i % elfs);
+        buffer_append(&xml, text, len);
+        const u32 count = lines / entries + (i < lines % entries);
+        for (u32 j = 0; j < count; j++)
+        {
+            const char *type = types[rng_next() % (sizeof(types) / sizeof(types[0]))];
+            if (!strcmp(type, "mask"))
+            {
+                len = snprintf(text, sizeof(text),
+                               "            <Line Type=\"mask\" Address=\"48 8B 05 ?? ?? ?? ?? %02X 89\" Value=\"9090%04X\" Offset=\"+%u\"/>\n",
+                               rng_next() & 0xff, rng_next() & 0xffff, rng_next() % 16);
+            }
+            else if (!strcmp(type, "bytes"))
+            {
+                len = snprintf(text, sizeof(text), "            <Line Type=\"bytes\" Address=\"0x%08x\" Value=\"%08X%04X\"/>\n",
+                               0x400000 + rng_next() % 0x1000000, rng_next(), rng_next() & 0xffff);
+            }
+            else if (!strcmp(type, "utf8"))
+            {
+                len = snprintf(text, sizeof(text), "            <Line Type=\"utf8\" Address=\"0x%08x\" Value=\"text %u\"/>\n",
+                               0x400000 + rng_next() % 0x1000000, rng_next());
+            }
+            else if (!strcmp(type, "float32"))
+            {
+                len = snprintf(text, sizeof(text), "            <Line Type=\"float32\" Address=\"0x%08x\" Value=\"%u.5\"/>\n",
+                               0x400000 + rng_next() % 0x1000000, rng_next() % 1000);
+            }
+            else
+            {
+                len = snprintf(text, sizeof(text), "            <Line Type=\"%s\" Address=\"0x%08x\" Value=\"0x%08x\"/>\n",
+                               type, 0x400000 + rng_next() % 0x1000000, rng_next() & (strcmp(type, "byte") ? ~0u : 0xffu));
+            }
+            buffer_append(&xml, text, len);
+        }
+        len = snprintf(text, sizeof(text), (broken && i + 1 == entries) ? "        </PatchList>\n" : "        </PatchList>\n    </Metadata>\n");
+        buffer_append(&xml, text, len);
+    }
+    buffer_append(&xml, "</Patch>\n", 10);
+    return (char *)xml.data;
+}
+
+struct thread_case_t
+{
+    char *xml;
+    u8 *ghp; // reference from one thread
+    u64 ghp_size;
+    bool ok;
+};
+
+struct thread_job_t
+{
+    thread_case_t *cases;
+    u32 seed;
+    u32 failed;
+};
+
+static void *compile_thread(void *arg)
+{
+    thread_job_t *job = (thread_job_t *)arg;
+    for (u32 round = 0; round < THREAD_ROUNDS; round++)
+    {
+        for (u32 i = 0; i < THREAD_XMLS; i++)
+        {
+            const thread_case_t *c = &job->cases[(i * 7 + job->seed + round) % THREAD_XMLS];
+            u8 *ghp = nullptr;
+            u64 size = 0;
+            const bool ok = ghp_compile(c->xml, "/data/GoldHEN/patches/xml/BENCH0000.xml", NULL, NULL, strlen(c->xml), 0, &ghp, &size);
+            job->failed += ok != c->ok || (ok && (size != c->ghp_size || memcmp(ghp, c->ghp, size)));
+            free(ghp);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * @brief ghp_compile() of the same files on THREAD_COUNT threads at once
+ *
+ * Every third file doesn't parse. Each compile has to report its own parse
+ * errors, not those of a file another thread is compiling at the time.
+ */
+static u32 check_threads(void)
+{
+    thread_case_t cases[THREAD_XMLS];
+    u32 broken = 0;
+    for (u32 i = 0; i < THREAD_XMLS; i++)
+    {
+        cases[i].xml = make_xml(8 + rng_next() % 64, 200 + rng_next() % 2000, 1 + rng_next() % 3, i % 3 == 2);
+        cases[i].ghp = nullptr;
+        cases[i].ok = ghp_compile(cases[i].xml, "/data/GoldHEN/patches/xml/BENCH0000.xml", NULL, NULL, strlen(cases[i].xml), 0,
+                                  &cases[i].ghp, &cases[i].ghp_size);
+        broken += !cases[i].ok;
+    }
+    thread_t threads[THREAD_COUNT];
+    thread_job_t jobs[THREAD_COUNT];
+    u32 started = 0;
+    for (u32 i = 0; i < THREAD_COUNT; i++)
+    {
+        jobs[i] = {cases, i * 5, 0};
+        if (!thread_start(&threads[i], compile_thread, &jobs[i], "ghp_bench"))
+        {
+            break;
+        }
+        started++;
+    }
+    u32 failed = 0;
+    for (u32 i = 0; i < started; i++)
+    {
+        thread_join(threads[i]);
+        failed += jobs[i].failed;
+    }
+    for (u32 i = 0; i < THREAD_XMLS; i++)
+    {
+        free(cases[i].ghp);
+        free(cases[i].xml);
+    }
+    failed += broken != THREAD_XMLS / 3 || started != THREAD_COUNT;
+    printf("threads: %u of %u compiles on %u threads differ from one thread (%u of %u files broken)\n", failed,
+           THREAD_COUNT * THREAD_ROUNDS * THREAD_XMLS, started, broken, THREAD_XMLS);
+    return failed;
+}
+
+static const char *dom_attr(mxml_node_t *node, const char *name)
+{
+    const char *value = mxmlElementGetAttr(node, name);
+    return value ? value : "";
+}
+
+// The walk before ghp_compile(), from main.cpp: the whole document as mxml nodes, every Metadata and Line visited
+static mxml_node_t *dom_walk(const char *xml, u32 *entries, u32 *lines, u64 *check)
+{
+    mxml_node_t *tree = mxmlLoadString(NULL, xml, MXML_NO_CALLBACK);
+    *entries = 0;
+    *lines = 0;
+    for (mxml_node_t *node = mxmlFindElement(tree, tree, "Metadata", NULL, NULL, MXML_DESCEND); node != NULL;
+         node = mxmlFindElement(node, tree, "Metadata", NULL, NULL, MXML_DESCEND))
+    {
+        *check += strlen(dom_attr(node, "Title")) + strlen(dom_attr(node, "Name")) + strlen(dom_attr(node, "AppVer")) +
+                  strlen(dom_attr(node, "AppElf"));
+        (*entries)++;
+        mxml_node_t *Patchlist_node = mxmlFindElement(node, node, "PatchList", NULL, NULL, MXML_DESCEND);
+        for (mxml_node_t *Line_node = mxmlFindElement(node, node, "Line", NULL, NULL, MXML_DESCEND); Line_node != NULL;
+             Line_node = mxmlFindElement(Line_node, Patchlist_node, "Line", NULL, NULL, MXML_DESCEND))
+        {
+            *check += strlen(dom_attr(Line_node, "Type")) + strlen(dom_attr(Line_node, "Address")) +
+                      strlen(dom_attr(Line_node, "Value"));
+            (*lines)++;
+        }
+    }
+    return tree;
+}
+
+/*
+ * @brief One xml of `size` bytes: DOM walk, SAX compile with and without the executable filter, load of the .ghp
+ *
+ * The entry and line counts of the DOM walk are checked against the
+ * unfiltered compile. Peaks are of the heap above what the xml text takes.
+ */
+static u32 bench(u64 size)
+{
+    const u32 lines = size / 84;
+    char *xml = make_xml(lines / 40 + 1, lines, 4, false);
+    const u64 xml_size = strlen(xml);
+    const u32 rounds = BENCH_BYTES / xml_size + 1;
+    u32 entries = 0;
+    u32 line_count = 0;
+    u64 check = 0;
+
+    u64 base = g_heap_live;
+    g_heap_peak = base;
+    double start = now_sec();
+    for (u32 r = 0; r < rounds; r++)
+    {
+        mxmlDelete(dom_walk(xml, &entries, &line_count, &check));
+    }
+    double dom_time = (now_sec() - start) / rounds;
+    const u64 dom_peak = g_heap_peak - base;
+
+    u8 *ghp = nullptr;
+    u64 ghp_size = 0;
+    g_heap_peak = base;
+    start = now_sec();
+    for (u32 r = 0; r < rounds; r++)
+    {
+        free(ghp);
+        ghp_compile(xml, "/data/GoldHEN/patches/xml/BENCH0000.xml", NULL, NULL, xml_size, 0, &ghp, &ghp_size);
+    }
+    double sax_time = (now_sec() - start) / rounds;
+    const u64 sax_peak = g_heap_peak - base;
+    const ghp_header_t *header = (const ghp_header_t *)ghp;
+    u32 failed = header->entry_count != entries || header->line_count != line_count;
+
+    u8 *filtered = nullptr;
+    u64 filtered_size = 0;
+    g_heap_peak = g_heap_live;
+    base = g_heap_live;
+    start = now_sec();
+    for (u32 r = 0; r < rounds; r++)
+    {
+        free(filtered);
+        ghp_compile(xml, "/data/GoldHEN/patches/xml/BENCH0000.xml", "eboot0.bin", "01.00", xml_size, 0, &filtered, &filtered_size);
+    }
+    double filtered_time = (now_sec() - start) / rounds;
+    const u64 filtered_peak = g_heap_peak - base;
+    failed += ((const ghp_header_t *)filtered)->entry_count != (entries + 3) / 4;
+
+    // as the plugin loads it on a later boot
+    Write_File(GHP_PATH, filtered, filtered_size);
+    const u32 load_rounds = rounds * 16;
+    start = now_sec();
+    for (u32 r = 0; r < load_rounds; r++)
+    {
+        char *data = nullptr;
+        u64 data_size = 0;
+        ghp_t loaded = {};
+        failed += Read_File(GHP_PATH, &data, &data_size, 0) || !ghp_open(&loaded, (u8 *)data, data_size) ||
+                  loaded.header->entry_count != ((const ghp_header_t *)filtered)->entry_count;
+        ghp_free(&loaded);
+    }
+    double load_time = (now_sec() - start) / load_rounds;
+    unlink(GHP_PATH);
+
+    printf("%.1f MB xml, %u entries, %u lines: DOM walk %.1f ms, %.1f MB peak; SAX compile %.1f ms, %.1f MB peak; "
+           "filtered %.1f ms, %.2f MB peak; load of %lu KB .ghp %.3f ms%s\n",
+           xml_size / 1048576.0, entries, line_count, dom_time * 1e3, dom_peak / 1048576.0, sax_time * 1e3,
+           sax_peak / 1048576.0, filtered_time * 1e3, filtered_peak / 1048576.0, filtered_size >> 10, load_time * 1e3,
+           failed ? ", counts differ" : "");
+    free(filtered);
+    free(ghp);
+    free(xml);
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    u32 failed = check_threads();
+    if (argc > 1)
+    {
+        failed += bench(strtoull(argv[1], NULL, 10) << 20);
+    }
+    else
+    {
+        failed += bench(1 << 20) + bench(4 << 20) + bench(16 << 20);
+    }
+    return failed ? 1 : 0;
+}
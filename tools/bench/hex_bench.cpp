@@ -0,0 +1,235 @@
+// Hex bench: fuzzes hex_decode() of hex.cpp against a plain reference
+// decoder, error positions included, then times it against the original
+// hexstrtochar2() on code cave sized payloads.
+// Usage: hex_bench [payload KB]
+
+#include <time.h>
+#include "hex.h"
+
+#define FUZZ_CASES 200000
+#define BENCH_BYTES (64 << 20)
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static u64 g_rng = 88172645463325252ull;
+
+static u32 rng_next(void)
+{
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return (u32)(g_rng >> 32);
+}
+
+// hex_lut of the original decoder, 0 for anything that is not a hex digit
+static u8 hex_lut[256];
+
+// The decoder before hex_decode(), from patch.cpp
+static u8 *hexstrtochar2(const char *hexstr, s64 *size)
+{
+    u32 str_len = strlen(hexstr);
+    s64 data_len = ((str_len + 1) / 2) * sizeof(u8);
+    *size = (str_len) * sizeof(u8);
+    u8 *data = (u8 *)malloc(*size);
+    u32 j = 0; // hexstr position
+    u32 i = 0; // data position
+
+    if (str_len % 2 == 1)
+    {
+        data[i] = (u8)(hex_lut[0] << 4) | hex_lut[(u8)hexstr[j]];
+        j = ++i;
+    }
+
+    for (; j < str_len; j += 2, i++)
+    {
+        data[i] = (u8)(hex_lut[(u8)hexstr[j]] << 4) | hex_lut[(u8)hexstr[j + 1]];
+    }
+
+    *size = data_len;
+    return data;
+}
+
+/*
+ * @brief One character at a time: whitespace skipped, anything else but
+ *        digits fails at its position, an odd digit count gets a leading 0
+ */
+static bool reference_decode(const char *str, u64 len, u8 *out, u64 *out_size, u64 *error_pos)
+{
+    char *digits = (char *)malloc(len + 2);
+    u64 count = 0;
+    for (u64 i = 0; i < len; i++)
+    {
+        const char c = str[i];
+        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))
+        {
+            digits[count++] = c;
+        }
+        else if (c != ' ' && c != '\t' && c != '\r' && c != '\n')
+        {
+            *error_pos = i;
+            free(digits);
+            return false;
+        }
+    }
+    if (count % 2)
+    {
+        memmove(digits + 1, digits, count++);
+        digits[0] = '0';
+    }
+    *out_size = count / 2;
+    for (u64 i = 0; i < count / 2; i++)
+    {
+        char byte[3] = {digits[i * 2], digits[i * 2 + 1], 0};
+        out[i] = (u8)strtoul(byte, NULL, 16);
+    }
+    free(digits);
+    return true;
+}
+
+/*
+ * @brief Random strings, mostly digits so the vector path runs
+ *
+ * Runs of digits are broken by whitespace and, now and then, a character
+ * that must fail the decode. Valid strings without whitespace are also
+ * compared with the original decoder.
+ */
+static u32 fuzz(void)
+{
+    static const char digits[] = "0123456789abcdefABCDEF";
+    static const char spaces[] = " \t\r\n";
+    static const char invalid[] = "xXgG-+;,.\x80\xff";
+    char str[512];
+    u8 out[512];
+    u8 expected[512];
+    u32 failed = 0;
+    u32 errors = 0;
+    u32 old_compared = 0;
+    for (u32 i = 0; i < FUZZ_CASES; i++)
+    {
+        const u32 len = rng_next() % 8 ? rng_next() % 64 : rng_next() % sizeof(str);
+        const u32 space_rate = rng_next() % 3 ? 0 : 1 + rng_next() % 20;
+        const u32 invalid_rate = rng_next() % 2 ? 0 : 1 + rng_next() % 400;
+        bool plain = true;
+        for (u32 j = 0; j < len; j++)
+        {
+            if (invalid_rate && rng_next() % invalid_rate == 0)
+            {
+                str[j] = invalid[rng_next() % (sizeof(invalid) - 1)];
+                plain = false;
+            }
+            else if (space_rate && rng_next() % space_rate == 0)
+            {
+                str[j] = spaces[rng_next() % (sizeof(spaces) - 1)];
+                plain = false;
+            }
+            else
+            {
+                str[j] = digits[rng_next() % (sizeof(digits) - 1)];
+            }
+        }
+        u64 size = 0, error_pos = 0;
+        u64 expected_size = 0, expected_pos = 0;
+        const bool ok = hex_decode(str, len, out, &size, &error_pos);
+        const bool expected_ok = reference_decode(str, len, expected, &expected_size, &expected_pos);
+        bool equal = ok == expected_ok &&
+                     (ok ? size == expected_size && !memcmp(out, expected, size) : error_pos == expected_pos);
+        if (ok && plain && len)
+        {
+            str[len] = 0;
+            s64 old_size = 0;
+            u8 *old = hexstrtochar2(str, &old_size);
+            equal = equal && (u64)old_size == size && !memcmp(old, out, size);
+            free(old);
+            old_compared++;
+        }
+        errors += !expected_ok;
+        if (!equal && failed++ < 3)
+        {
+            fprintf(stderr, "case %u differs: \"%.*s\"\n", i, len, str);
+        }
+    }
+    printf("fuzz: %u of %u differ (%u invalid, %u also against the original)\n", failed, FUZZ_CASES, errors,
+           old_compared);
+    return failed;
+}
+
+// Decode a payload until BENCH_BYTES of hex have been read, the original with its malloc per call
+static u32 bench(u32 payload)
+{
+    char *str = (char *)malloc(payload * 3 + 1);
+    for (u32 i = 0; i < payload * 2; i++)
+    {
+        str[i] = "0123456789ABCDEF"[rng_next() % 16];
+    }
+    str[payload * 2] = 0;
+    const u32 rounds = BENCH_BYTES / (payload * 2);
+    u8 *out = (u8 *)malloc(hex_decoded_max(payload * 3));
+    u64 check = 0;
+
+    double start = now_sec();
+    for (u32 r = 0; r < rounds; r++)
+    {
+        s64 size = 0;
+        u8 *data = hexstrtochar2(str, &size);
+        check += data[r % size];
+        free(data);
+    }
+    double old_time = now_sec() - start;
+
+    start = now_sec();
+    for (u32 r = 0; r < rounds; r++)
+    {
+        u64 size = 0, error_pos = 0;
+        hex_decode(str, payload * 2, out, &size, &error_pos);
+        check -= out[r % size];
+    }
+    double time = now_sec() - start;
+
+    // "48 8B 05 ..." as patch files often write it, the original can't read it
+    for (u32 i = payload; i-- > 0;)
+    {
+        str[i * 3] = str[i * 2];
+        str[i * 3 + 1] = str[i * 2 + 1];
+        str[i * 3 + 2] = ' ';
+    }
+    start = now_sec();
+    for (u32 r = 0; r < rounds; r++)
+    {
+        u64 size = 0, error_pos = 0;
+        hex_decode(str, payload * 3, out, &size, &error_pos);
+    }
+    double spaced_time = now_sec() - start;
+    printf("%u byte payload: hex_decode %.2f GB/s, spaced %.2f GB/s, original %.2f GB/s%s\n", payload,
+           (double)rounds * payload * 2 / time / 1e9, (double)rounds * payload * 3 / spaced_time / 1e9,
+           (double)rounds * payload * 2 / old_time / 1e9, check ? ", outputs differ" : "");
+    free(out);
+    free(str);
+    return check != 0;
+}
+
+int main(int argc, char **argv)
+{
+    for (u32 c = '0'; c <= '9'; c++)
+    {
+        hex_lut[c] = c - '0';
+    }
+    for (u32 c = 'a'; c <= 'f'; c++)
+    {
+        hex_lut[c] = hex_lut[c - 0x20] = c - 'a' + 10;
+    }
+    u32 failed = fuzz();
+    if (argc > 1)
+    {
+        failed += bench((u32)atoi(argv[1]) << 10);
+    }
+    else
+    {
+        failed += bench(64) + bench(1 << 10) + bench(8 << 10);
+    }
+    return failed ? 1 : 0;
+}
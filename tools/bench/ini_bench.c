@@ -0,0 +1,483 @@
+// INI bench: checks common/ini.c against the original fgetc() parser and
+// its indexed lookups against linear ones, then times it on a generated
+// plugins.ini, on a range of file sizes and section sizes.
+// Usage: ini_bench [sections]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "plugin_common.h"
+#include "ini.h"
+#include "ini_fgetc.h"
+
+#define RANDOM_CASES 200000
+#define BENCH_REPEAT 30
+#define INDEX_CASES 2000
+
+// Allocator calls, counted through the linker's --wrap, see the Makefile
+static unsigned long g_allocs = 0;
+static unsigned long g_frees = 0;
+
+void *__real_malloc(size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size)
+{
+    g_allocs++;
+    return __real_malloc(size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    g_allocs++;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr)
+{
+    g_frees += ptr != NULL;
+    __real_free(ptr);
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void write_file(const char *path, const char *data, size_t size)
+{
+    FILE *file = fopen(path, "wb");
+    fwrite(data, 1, size, file);
+    fclose(file);
+}
+
+static bool tables_equal(const fgetc_ini_table_s *a, const ini_table_s *b)
+{
+    if (a->size != b->size)
+    {
+        return false;
+    }
+    for (int i = 0; i < a->size; i++)
+    {
+        const fgetc_ini_section_s *sa = &a->section[i];
+        const ini_section_s *sb = &b->section[i];
+        if (sa->size != sb->size || strcmp(sa->name, sb->name))
+        {
+            return false;
+        }
+        for (int j = 0; j < sa->size; j++)
+        {
+            if (strcmp(sa->entry[j].key, sb->entry[j].key) || strcmp(sa->entry[j].value, sb->entry[j].value))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Parse `text' with both parsers, from a file and in place with ini_table_parse()
+static bool parse_equal(const char *path, const char *text, size_t size)
+{
+    write_file(path, text, size);
+    fgetc_ini_table_s *expected = fgetc_ini_table_create();
+    fgetc_ini_table_read_from_file(expected, path);
+    ini_table_s *from_file = ini_table_create();
+    ini_table_read_from_file(from_file, path);
+    char *copy = (char *)malloc(size + 1);
+    memcpy(copy, text, size);
+    ini_table_s *in_place = ini_table_create();
+    ini_table_parse(in_place, copy, size);
+    bool equal = tables_equal(expected, from_file) && tables_equal(expected, in_place);
+    ini_table_destroy(in_place);
+    free(copy);
+    ini_table_destroy(from_file);
+    fgetc_ini_table_destroy(expected);
+    return equal;
+}
+
+static u32 test_fixed(const char *path)
+{
+    static const char *cases[] = {
+        "",
+        "[default]\n/data/GoldHEN/plugins/game_patch.prx\n",
+        "[settings]\r\nshow_load_notification=true\r\n\r\n[CUSA00001]\r\n/data/a.prx\r\n",
+        "[default]\n  spaced key  =  spaced value  \n",
+        "[default]\nkey=value ; comment\n; whole line\n",
+        "[default]\nno_newline_at_end=1",
+        "[default]\n; comment at the end",
+        "key_before_section=1\n[s]\nk=v\n",
+        "[missing bracket\nk=v\n",
+        "[a]k=v\n[b] x = y\n",
+        "[a]\nx\nab\n=v\nk==v\n",
+        "[a]\ntab\t=\tvalue\t\n",
+        "[dup]\nk=1\n[dup]\nk=2\n",
+        "\n\n\n[a]\n\n\nk=v\n\n",
+    };
+    u32 failed = 0;
+    for (u32 i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        if (!parse_equal(path, cases[i], strlen(cases[i])))
+        {
+            fprintf(stderr, "fixed case %u differs:\n%s\n", i, cases[i]);
+            failed++;
+        }
+    }
+    printf("fixed cases: %u of %zu differ\n", failed, sizeof(cases) / sizeof(cases[0]));
+    return failed;
+}
+
+static u32 test_random(const char *path)
+{
+    static const char alphabet[] = " \r\n[]=;ab\tx\0Z";
+    char text[256];
+    u32 failed = 0;
+    srand(7);
+    for (u32 i = 0; i < RANDOM_CASES; i++)
+    {
+        size_t size = rand() % 200;
+        for (size_t j = 0; j < size; j++)
+        {
+            text[j] = alphabet[rand() % sizeof(alphabet)];
+        }
+        if (!parse_equal(path, text, size) && failed++ < 3)
+        {
+            fprintf(stderr, "random case %u differs:\n", i);
+            fwrite(text, 1, size, stderr);
+            fputc('\n', stderr);
+        }
+    }
+    printf("random cases: %u of %u differ\n", failed, RANDOM_CASES);
+    return failed;
+}
+
+// A second parse in the same process must still see an unterminated last line
+static u32 test_reparse(const char *path)
+{
+    static const char text[] = "[default]\n/data/a.prx\n[CUSA00001]\nlast=line";
+    write_file(path, text, sizeof(text) - 1);
+    u32 failed = 0;
+    for (u32 i = 0; i < 2; i++)
+    {
+        ini_table_s *table = ini_table_create();
+        ini_table_read_from_file(table, path);
+        failed += ini_table_get_entry(table, "CUSA00001", "last") == NULL;
+        ini_table_destroy(table);
+    }
+    printf("reparse: last line missing in %u of 2 parses\n", failed);
+    return failed;
+}
+
+// plugins.ini with a [default] section and `sections' title sections
+static char *make_plugins_ini(u32 sections, size_t *size)
+{
+    size_t capacity = sections * 400 + 1024;
+    char *text = (char *)malloc(capacity);
+    size_t len = sprintf(text, "[settings]\nshow_load_notification=true\r\n\n[default]\n/data/GoldHEN/plugins/game_patch.prx\n");
+    for (u32 i = 0; i < sections; i++)
+    {
+        len += sprintf(text + len,
+                       "\n; title %u\n[CUSA%05u]\n/data/GoldHEN/plugins/afr.prx\n"
+                       "  /data/GoldHEN/plugins/no_share_watermark.prx ; note\n"
+                       "enableDeadZone = 1\nDeadZoneLeft=%u\nTOUCH_L2=BUTTON_L3\nVirationIntensity = medium\n",
+                       i, i, i % 128);
+    }
+    *size = len;
+    return text;
+}
+
+// Table storage: one allocation per string and array before, arena blocks now
+static void bench_arena(const char *path, const char *text, size_t size)
+{
+    write_file(path, text, size);
+    g_allocs = g_frees = 0;
+    fgetc_ini_table_s *old_table = fgetc_ini_table_create();
+    fgetc_ini_table_read_from_file(old_table, path);
+    unsigned long old_allocs = g_allocs;
+    g_frees = 0;
+    fgetc_ini_table_destroy(old_table);
+    unsigned long old_frees = g_frees;
+
+    g_allocs = g_frees = 0;
+    ini_table_s *table = ini_table_create();
+    ini_table_read_from_file(table, path);
+    unsigned long allocs = g_allocs;
+    u32 blocks = 0;
+    for (const ini_block_s *block = table->arena; block; block = block->next)
+    {
+        blocks++;
+    }
+    g_frees = 0;
+    ini_table_destroy(table);
+    printf("arena: build %lu allocations (fgetc parser %lu), destroy %lu frees (%lu), %u arena blocks\n",
+           allocs, old_allocs, g_frees, old_frees, blocks);
+
+    double start = now_sec();
+    for (u32 i = 0; i < BENCH_REPEAT; i++)
+    {
+        fgetc_ini_table_s *t = fgetc_ini_table_create();
+        fgetc_ini_table_read_from_file(t, path);
+        fgetc_ini_table_destroy(t);
+    }
+    double old_time = (now_sec() - start) / BENCH_REPEAT;
+    start = now_sec();
+    for (u32 i = 0; i < BENCH_REPEAT; i++)
+    {
+        ini_table_s *t = ini_table_create();
+        ini_table_read_from_file(t, path);
+        ini_table_destroy(t);
+    }
+    double new_time = (now_sec() - start) / BENCH_REPEAT;
+    char *work = (char *)malloc(size + 1);
+    double parse_time = 0;
+    for (u32 i = 0; i < BENCH_REPEAT; i++)
+    {
+        memcpy(work, text, size);
+        start = now_sec();
+        ini_table_s *t = ini_table_create();
+        ini_table_parse(t, work, size);
+        ini_table_destroy(t);
+        parse_time += now_sec() - start;
+    }
+    parse_time /= BENCH_REPEAT;
+    free(work);
+    printf("arena: read, build and destroy %.2f ms (fgetc parser %.2f ms), in-place parse %.2f ms (%.0f MB/s)\n",
+           new_time * 1e3, old_time * 1e3, parse_time * 1e3, size / parse_time / 1e6);
+}
+
+// Read, build and destroy from a file of each size, both parsers
+static void bench_read(const char *path)
+{
+    static const u32 sizes[] = {10, 100, 1000, 10000};
+    for (u32 s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        size_t size = 0;
+        char *text = make_plugins_ini(sizes[s], &size);
+        write_file(path, text, size);
+        free(text);
+        const u32 repeat = sizes[s] < 1000 ? BENCH_REPEAT * 10 : BENCH_REPEAT;
+        double start = now_sec();
+        for (u32 i = 0; i < repeat; i++)
+        {
+            fgetc_ini_table_s *t = fgetc_ini_table_create();
+            fgetc_ini_table_read_from_file(t, path);
+            fgetc_ini_table_destroy(t);
+        }
+        double old_time = (now_sec() - start) / repeat;
+        start = now_sec();
+        for (u32 i = 0; i < repeat; i++)
+        {
+            ini_table_s *t = ini_table_create();
+            ini_table_read_from_file(t, path);
+            ini_table_destroy(t);
+        }
+        double new_time = (now_sec() - start) / repeat;
+        printf("read, %5u sections, %8zu bytes: %8.3f ms (fgetc parser %8.3f ms), %.1fx\n", sizes[s], size,
+               new_time * 1e3, old_time * 1e3, old_time / new_time);
+    }
+}
+
+// Random tables with duplicate names, looked up linear and indexed, before and after entries are created
+static u32 test_index(void)
+{
+    static const char *names[] = {"a", "b", "c", "d", "e", "f", "g", "h", "CUSA00001", "CUSA00002",
+                                  "default", "settings", "key", "Key", "x y", "a_longer_name_0123456789"};
+    const u32 name_count = sizeof(names) / sizeof(names[0]);
+    u32 failed = 0;
+    srand(11);
+    for (u32 i = 0; i < INDEX_CASES; i++)
+    {
+        char *text = (char *)malloc(64 * 1024);
+        size_t len = 0;
+        const u32 sections = 1 + rand() % 40;
+        for (u32 s = 0; s < sections; s++)
+        {
+            len += sprintf(text + len, "[%s]\n", names[rand() % name_count]);
+            const u32 keys = rand() % 30;
+            for (u32 k = 0; k < keys; k++)
+            {
+                len += sprintf(text + len, "%s=%d\n", names[rand() % name_count], rand() % 1000);
+            }
+        }
+        char *copy = (char *)malloc(len + 1);
+        memcpy(copy, text, len);
+        ini_table_s *linear = ini_table_create();
+        ini_table_parse(linear, text, len);
+        ini_table_s *indexed = ini_table_create();
+        ini_table_parse(indexed, copy, len);
+        ini_table_build_index(indexed);
+        bool equal = true;
+        for (u32 round = 0; round < 2 && equal; round++)
+        {
+            for (u32 s = 0; s < name_count && equal; s++)
+            {
+                for (u32 k = 0; k < name_count && equal; k++)
+                {
+                    const char *a = ini_table_get_entry(linear, names[s], names[k]);
+                    const char *b = ini_table_get_entry(indexed, names[s], names[k]);
+                    equal = (a == NULL) == (b == NULL) && (a == NULL || !strcmp(a, b));
+                }
+            }
+            // new and existing names, enough to grow the indexes
+            for (u32 n = 0; n < 40 && round == 0; n++)
+            {
+                char value[16];
+                snprintf(value, sizeof(value), "new%u", n);
+                const char *section = names[rand() % name_count];
+                const char *key = names[rand() % name_count];
+                ini_table_create_entry(linear, section, key, value);
+                ini_table_create_entry(indexed, section, key, value);
+            }
+        }
+        if (!equal && failed++ < 3)
+        {
+            fprintf(stderr, "index case %u differs:\n%.*s\n", i, (int)len, copy);
+        }
+        ini_table_destroy(indexed);
+        ini_table_destroy(linear);
+        free(copy);
+        free(text);
+    }
+    printf("index: %u of %u tables differ from linear lookups\n", failed, INDEX_CASES);
+    return failed;
+}
+
+/*
+ * @brief 26 lookups in the last title section, as gamepad_helper's
+ *        load_config() does, for a growing number of title sections
+ *
+ * The boot column is what one start pays: building the index, then
+ * [default] and the 26 lookups, against the same lookups without it.
+ */
+static void bench_index(void)
+{
+    static const u32 counts[] = {100, 500, 1000, 3000, 10000};
+    static const char *keys[] = {"enableDeadZone", "DeadZoneLeft", "TOUCH_L2", "VirationIntensity", "missing"};
+    const u32 lookups = 26;
+    for (u32 c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        size_t size = 0;
+        char *text = make_plugins_ini(counts[c], &size);
+        char section[16];
+        snprintf(section, sizeof(section), "CUSA%05u", counts[c] - 1);
+        double times[2] = {0, 0};
+        double boot[2] = {0, 0};
+        for (u32 indexed = 0; indexed < 2; indexed++)
+        {
+            char *work = (char *)malloc(size + 1);
+            for (u32 r = 0; r < BENCH_REPEAT; r++)
+            {
+                memcpy(work, text, size);
+                ini_table_s *table = ini_table_create();
+                ini_table_parse(table, work, size);
+                double start = now_sec();
+                if (indexed)
+                {
+                    ini_table_build_index(table);
+                }
+                u32 found = ini_table_get_entry(table, "default", "/data/GoldHEN/plugins/game_patch.prx") != NULL;
+                double lookup_start = now_sec();
+                for (u32 i = 0; i < lookups; i++)
+                {
+                    found += ini_table_get_entry(table, section, keys[i % 5]) != NULL;
+                }
+                times[indexed] += now_sec() - lookup_start;
+                boot[indexed] += now_sec() - start;
+                if (found != 1 + lookups - lookups / 5)
+                {
+                    fprintf(stderr, "index: %u lookups found, expected %u\n", found, 1 + lookups - lookups / 5);
+                }
+                ini_table_destroy(table);
+            }
+            free(work);
+        }
+        printf("index, %5u sections: %u lookups %8.2f us linear, %5.2f us indexed; boot %8.2f us, indexed %8.2f us\n",
+               counts[c], lookups, times[0] / BENCH_REPEAT * 1e6, times[1] / BENCH_REPEAT * 1e6,
+               boot[0] / BENCH_REPEAT * 1e6, boot[1] / BENCH_REPEAT * 1e6);
+        free(text);
+    }
+}
+
+// Every key of one section, for sizes around the point where ini.c starts indexing keys
+static void bench_keys(void)
+{
+    static const u32 counts[] = {2, 4, 7, 8, 16, 64, 256};
+    const u32 repeat = BENCH_REPEAT * 100;
+    for (u32 c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        char *text = (char *)malloc(counts[c] * 32 + 64);
+        char (*keys)[24] = (char (*)[24])malloc(counts[c] * 24);
+        size_t size = sprintf(text, "[CUSA00001]\n");
+        for (u32 k = 0; k < counts[c]; k++)
+        {
+            snprintf(keys[k], 24, "setting_%u", k);
+            size += sprintf(text + size, "%s=%u\n", keys[k], k);
+        }
+        double times[2] = {0, 0};
+        double first = 0;
+        for (u32 indexed = 0; indexed < 2; indexed++)
+        {
+            char *work = (char *)malloc(size + 1);
+            memcpy(work, text, size);
+            ini_table_s *table = ini_table_create();
+            ini_table_parse(table, work, size);
+            if (indexed)
+            {
+                ini_table_build_index(table);
+            }
+            double start = now_sec();
+            ini_table_get_entry(table, "CUSA00001", "setting_0");
+            if (indexed)
+            {
+                first = now_sec() - start;
+            }
+            u32 found = 0;
+            start = now_sec();
+            for (u32 r = 0; r < repeat; r++)
+            {
+                found += ini_table_get_entry(table, "CUSA00001", keys[r % counts[c]]) != NULL;
+            }
+            times[indexed] = (now_sec() - start) / repeat;
+            if (found != repeat)
+            {
+                fprintf(stderr, "keys: %u of %u found\n", found, repeat);
+            }
+            ini_table_destroy(table);
+            free(work);
+        }
+        printf("keys, %3u in the section: %6.1f ns a lookup linear, %6.1f ns indexed, first indexed lookup %6.2f us\n",
+               counts[c], times[0] * 1e9, times[1] * 1e9, first * 1e6);
+        free(keys);
+        free(text);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    u32 sections = argc > 1 ? (u32)atoi(argv[1]) : 3000;
+    char path[] = "/tmp/ini_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+    u32 failed = test_fixed(path) + test_random(path) + test_reparse(path) + test_index();
+    size_t size = 0;
+    char *text = make_plugins_ini(sections, &size);
+    failed += !parse_equal(path, text, size);
+    printf("plugins.ini, %u sections, %zu bytes: tables %s\n", sections, size, failed ? "differ" : "equal");
+    bench_arena(path, text, size);
+    bench_read(path);
+    bench_index();
+    bench_keys();
+    free(text);
+    unlink(path);
+    return failed ? 1 : 0;
+}
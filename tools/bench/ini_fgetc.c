@@ -8,13 +8,13 @@
 #define _atoi atoi
 
 /// https://github.com/Teklad/tconfig > https://github.com/gimli2/tconfig
-#include "config.h"
+#include "ini_fgetc.h"
 
-static ini_entry_s *_ini_entry_create(ini_section_s *section, const char *key, const char *value) {
+static fgetc_ini_entry_s *_fgetc_ini_entry_create(fgetc_ini_section_s *section, const char *key, const char *value) {
     if ((section->size % 10) == 0) {
-        section->entry = (ini_entry_s *)realloc(section->entry, (10 + section->size) * sizeof(ini_entry_s));
+        section->entry = (fgetc_ini_entry_s *)realloc(section->entry, (10 + section->size) * sizeof(fgetc_ini_entry_s));
     }
-    ini_entry_s *entry = &section->entry[section->size++];
+    fgetc_ini_entry_s *entry = &section->entry[section->size++];
     entry->key = (char *)malloc((strlen(key) + 1) * sizeof(char));
     entry->value = (char *)malloc((strlen(value) + 1) * sizeof(char));
     debug_printf("key: %s = value: %s\n", key, value);
@@ -23,20 +23,19 @@ static ini_entry_s *_ini_entry_create(ini_section_s *section, const char *key, c
     return entry;
 }
 
-static ini_section_s *_ini_section_create(ini_table_s *table, const char *section_name) {
+static fgetc_ini_section_s *_fgetc_ini_section_create(fgetc_ini_table_s *table, const char *section_name) {
     if ((table->size % 10) == 0) {
-        table->section = (ini_section_s *)realloc(table->section, (10 + table->size) * sizeof(ini_section_s));
+        table->section = (fgetc_ini_section_s *)realloc(table->section, (10 + table->size) * sizeof(fgetc_ini_section_s));
     }
-    ini_section_s *section = &table->section[table->size++];
+    fgetc_ini_section_s *section = &table->section[table->size++];
     section->size = 0;
     section->name = (char *)malloc((strlen(section_name) + 1) * sizeof(char));
     strcpy(section->name, section_name);
-    section->entry = (ini_entry_s *)malloc(10 * sizeof(ini_entry_s));
+    section->entry = (fgetc_ini_entry_s *)malloc(10 * sizeof(fgetc_ini_entry_s));
     return section;
 }
 
-// Ctn: make this non-static
-ini_section_s *_ini_section_find(ini_table_s *table, const char *name) {
+fgetc_ini_section_s *_fgetc_ini_section_find(fgetc_ini_table_s *table, const char *name) {
     for (int i = 0; i < table->size; i++) {
         if (strcmp(table->section[i].name, name) == 0) {
             return &table->section[i];
@@ -45,7 +44,7 @@ ini_section_s *_ini_section_find(ini_table_s *table, const char *name) {
     return NULL;
 }
 
-static ini_entry_s *_ini_entry_find(ini_section_s *section, const char *key) {
+static fgetc_ini_entry_s *_fgetc_ini_entry_find(fgetc_ini_section_s *section, const char *key) {
     for (int i = 0; i < section->size; i++) {
         if (strcmp(section->entry[i].key, key) == 0) {
             return &section->entry[i];
@@ -54,31 +53,31 @@ static ini_entry_s *_ini_entry_find(ini_section_s *section, const char *key) {
     return NULL;
 }
 
-static ini_entry_s *_ini_entry_get(ini_table_s *table, const char *section_name, const char *key) {
-    ini_section_s *section = _ini_section_find(table, section_name);
+static fgetc_ini_entry_s *_fgetc_ini_entry_get(fgetc_ini_table_s *table, const char *section_name, const char *key) {
+    fgetc_ini_section_s *section = _fgetc_ini_section_find(table, section_name);
     if (section == NULL) {
         return NULL;
     }
 
-    ini_entry_s *entry = _ini_entry_find(section, key);
+    fgetc_ini_entry_s *entry = _fgetc_ini_entry_find(section, key);
     if (entry == NULL) {
         return NULL;
     }
     return entry;
 }
 
-ini_table_s *ini_table_create() {
-    ini_table_s *table = (ini_table_s *)malloc(sizeof(ini_table_s));
+fgetc_ini_table_s *fgetc_ini_table_create() {
+    fgetc_ini_table_s *table = (fgetc_ini_table_s *)malloc(sizeof(fgetc_ini_table_s));
     table->size = 0;
-    table->section = (ini_section_s *)malloc(10 * sizeof(ini_section_s));
+    table->section = (fgetc_ini_section_s *)malloc(10 * sizeof(fgetc_ini_section_s));
     return table;
 }
 
-void ini_table_destroy(ini_table_s *table) {
+void fgetc_ini_table_destroy(fgetc_ini_table_s *table) {
     for (int i = 0; i < table->size; i++) {
-        ini_section_s *section = &table->section[i];
+        fgetc_ini_section_s *section = &table->section[i];
         for (int q = 0; q < section->size; q++) {
-            ini_entry_s *entry = &section->entry[q];
+            fgetc_ini_entry_s *entry = &section->entry[q];
             free(entry->key);
             free(entry->value);
         }
@@ -89,9 +88,9 @@ void ini_table_destroy(ini_table_s *table) {
     free(table);
 }
 
-int eof_hack(int c) {
-    static bool first_time = true;
+static bool first_time = true;
 
+static int eof_hack(int c) {
     if (first_time && c == EOF) {
         first_time = false;
         return INT_MAX;
@@ -100,10 +99,11 @@ int eof_hack(int c) {
     return EOF;
 }
 
-bool ini_table_read_from_file(ini_table_s* table, const char* file)
+bool fgetc_ini_table_read_from_file(fgetc_ini_table_s* table, const char* file)
 {
     FILE* f = fopen(file, "r");
     if (f == NULL) return false;
+    first_time = true;
 
     enum {Section, Key, Value, Comment} state = Section;
     int   c;
@@ -114,7 +114,7 @@ bool ini_table_read_from_file(ini_table_s* table, const char* file)
     char* buf   = (char*)malloc(buffer_size);
     char* value = NULL;
 
-    ini_section_s* current_section = NULL;
+    fgetc_ini_section_s* current_section = NULL;
     memset(buf, '\0', buffer_size);
 
     bool first_eol = false;
@@ -157,20 +157,20 @@ bool ini_table_read_from_file(ini_table_s* table, const char* file)
                 line++;
                 if (state == Value) {
                     if (current_section == NULL) {
-                        current_section = _ini_section_create(table, "");
+                        current_section = _fgetc_ini_section_create(table, "");
                     }
-                    _ini_entry_create(current_section, buf, value);
+                    _fgetc_ini_entry_create(current_section, buf, value);
                     value = NULL;
                 } else if (strlen(buf) > 1 && position && state == Key) {
                     if (current_section == NULL) {
-                        current_section = _ini_section_create(table, "");
+                        current_section = _fgetc_ini_section_create(table, "");
                     }
-                    _ini_entry_create(current_section, buf, "");
+                    _fgetc_ini_entry_create(current_section, buf, "");
                 } else if (state == Comment) {
                     if (current_section == NULL) {
-                        current_section = _ini_section_create(table, "");
+                        current_section = _fgetc_ini_section_create(table, "");
                     }
-                    _ini_entry_create(current_section, buf, "");
+                    _fgetc_ini_entry_create(current_section, buf, "");
                 } else if (state == Section) {
                     debug_printf("Section `%s' missing `]' operator.", buf);
                 } else if(state == Key && position) {
@@ -185,7 +185,7 @@ bool ini_table_read_from_file(ini_table_s* table, const char* file)
                 state = Section;
                 break;
             case ']':
-                current_section = _ini_section_create(table, buf);
+                current_section = _fgetc_ini_section_create(table, buf);
                 memset(buf, '\0', buffer_size);
                 position = 0;
                 spaces = 0;
@@ -212,73 +212,10 @@ bool ini_table_read_from_file(ini_table_s* table, const char* file)
     return true;
 }
 
-bool ini_table_write_to_file(ini_table_s *table, const char *file) {
-    FILE *f = fopen(file, "w+");
-    if (f == NULL)
-        return false;
-    for (int i = 0; i < table->size; i++) {
-        ini_section_s *section = &table->section[i];
-        fprintf(f, i > 0 ? "\n[%s]\n" : "[%s]\n", section->name);
-        for (int q = 0; q < section->size; q++) {
-            ini_entry_s *entry = &section->entry[q];
-            if (entry->key[0] == ';') {
-                fprintf(f, "%s\n", entry->key);
-            } else {
-                fprintf(f, "%s = %s\n", entry->key, entry->value);
-            }
-        }
-    }
-    if (fflush(f) == 0)
-        fsync(fileno(f));
-    fclose(f);
-    return true;
-}
-
-void ini_table_create_entry(ini_table_s *table, const char *section_name, const char *key, const char *value) {
-    ini_section_s *section = _ini_section_find(table, section_name);
-    if (section == NULL) {
-        section = _ini_section_create(table, section_name);
-    }
-    ini_entry_s *entry = _ini_entry_find(section, key);
-    if (entry == NULL) {
-        entry = _ini_entry_create(section, key, value);
-    } else {
-        free(entry->value);
-        entry->value = (char *)malloc((strlen(value) + 1) * sizeof(char));
-        strcpy(entry->value, value);
-    }
-}
-
-bool ini_table_check_entry(ini_table_s *table, const char *section_name, const char *key) {
-    return (_ini_entry_get(table, section_name, key) != NULL);
-}
-
-const char *ini_table_get_entry(ini_table_s *table, const char *section_name, const char *key) {
-    ini_entry_s *entry = _ini_entry_get(table, section_name, key);
+const char *fgetc_ini_table_get_entry(fgetc_ini_table_s *table, const char *section_name, const char *key) {
+    fgetc_ini_entry_s *entry = _fgetc_ini_entry_get(table, section_name, key);
     if (entry == NULL) {
         return NULL;
     }
     return entry->value;
 }
-
-bool ini_table_get_entry_as_int(ini_table_s *table, const char *section_name, const char *key, int *value) {
-    const char *val = ini_table_get_entry(table, section_name, key);
-    if (val == NULL) {
-        return false;
-    }
-    *value = _atoi(val);
-    return true;
-}
-
-bool ini_table_get_entry_as_bool(ini_table_s *table, const char *section_name, const char *key, bool *value) {
-    const char *val = ini_table_get_entry(table, section_name, key);
-    if (val == NULL) {
-        return false;
-    }
-    if (strcasecmp(val, "on") == 0 || strcasecmp(val, "true") == 0 || strcasecmp(val, "1") == 0) {
-        *value = true;
-    } else {
-        *value = false;
-    }
-    return true;
-}
@@ -0,0 +1,29 @@
+// The original fgetc() INI parser of plugin_loader (source/config.c before
+// common/ini.c), kept as the reference ini_bench checks common/ini.c against.
+// Symbols are prefixed with fgetc_. eof_hack()'s static is reset by every
+// read, the original dropped an unterminated last line on a second parse.
+#pragma once
+
+#include <stdbool.h>
+
+typedef struct fgetc_ini_entry_s {
+    char *key;
+    char *value;
+} fgetc_ini_entry_s;
+
+typedef struct fgetc_ini_section_s {
+    char *name;
+    fgetc_ini_entry_s *entry;
+    int size;
+} fgetc_ini_section_s;
+
+typedef struct fgetc_ini_table_s {
+    fgetc_ini_section_s *section;
+    int size;
+} fgetc_ini_table_s;
+
+fgetc_ini_table_s *fgetc_ini_table_create();
+void fgetc_ini_table_destroy(fgetc_ini_table_s *table);
+bool fgetc_ini_table_read_from_file(fgetc_ini_table_s *table, const char *file);
+const char *fgetc_ini_table_get_entry(fgetc_ini_table_s *table, const char *section_name, const char *key);
+fgetc_ini_section_s *_fgetc_ini_section_find(fgetc_ini_table_s *table, const char *name);
@@ -0,0 +1,494 @@
+// Scan bench: checks the pattern scanner and signature tables of scan.cpp
+// against a naive masked compare, then times them against the original
+// byte-by-byte PatternScan() on a buffer with the byte distribution of
+// x86-64 code, and times the parallel scan at each thread count. Signature
+// caches saved by a cold resolve must resolve everything without a scan.
+// Usage: scan_bench [buffer MB]
+
+#include <time.h>
+#include <sys/mman.h>
+#include "scan.h"
+#include "cache.h"
+
+#define CHECK_CASES 20000
+#define BENCH_SIGNATURES 16
+#define BENCH_PATTERN_LENGTH 16
+#define TABLE_CASES 300
+#define TABLE_SIGNATURES 48
+#define PARALLEL_CASES 60
+#define CACHE_CASES 40
+#define CACHE_PATH "/tmp/scan_bench_cache.bin"
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static u64 g_rng = 88172645463325252ull;
+
+static u32 rng_next(void)
+{
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return (u32)(g_rng >> 32);
+}
+
+// first match of the compiled pattern, one position at a time
+static u8 *naive_find(const pattern_t *pattern, u64 base, u64 size)
+{
+    const u8 *data = (const u8 *)base;
+    for (u64 i = 0; i + pattern->length <= size; i++)
+    {
+        s32 j = 0;
+        while (j < pattern->length && (!pattern->mask[j] || data[i + j] == pattern->bytes[j]))
+        {
+            j++;
+        }
+        if (j == pattern->length)
+        {
+            return (u8 *)data + i;
+        }
+    }
+    return nullptr;
+}
+
+// The scanner before pattern_compile(), from main.cpp. FF is a wildcard in
+// it, so the benchmark signatures have none. The loop stops at the end of the
+// buffer, the original read up to the pattern length past it.
+static s32 original_pattern_to_byte(const char *pattern, u8 *bytes)
+{
+    s32 count = 0;
+    const char *end = pattern + strlen(pattern);
+    for (const char *current = pattern; current < end; ++current)
+    {
+        if (*current == ' ')
+            continue;
+        if (*current == '?')
+        {
+            ++current;
+            if (*current == '?')
+            {
+                ++current;
+            }
+            bytes[count++] = -1;
+        }
+        else
+        {
+            bytes[count++] = strtoul(current, (char **)&current, 16);
+        }
+    }
+    return count;
+}
+
+static u8 *original_pattern_scan(u64 module_base, u64 module_size, const char *signature)
+{
+    u8 patternBytes[MAX_PATTERN_LENGTH];
+    s32 patternLength = original_pattern_to_byte(signature, patternBytes);
+    u8 *scanBytes = (u8 *)module_base;
+    for (u64 i = 0; i + patternLength <= module_size; ++i)
+    {
+        bool found = true;
+        for (s32 j = 0; j < patternLength; ++j)
+        {
+            if (scanBytes[i + j] != patternBytes[j] && patternBytes[j] != 0xff)
+            {
+                found = false;
+                break;
+            }
+        }
+        if (found)
+        {
+            return &scanBytes[i];
+        }
+    }
+    return nullptr;
+}
+
+// Random low-entropy buffers and patterns taken from them, with wildcards and stray bytes
+static u32 check_patterns(void)
+{
+    u32 failed = 0;
+    u8 *buffer = (u8 *)malloc(4096);
+    for (u32 i = 0; i < CHECK_CASES; i++)
+    {
+        const u32 size = 1 + rng_next() % 3000;
+        for (u32 j = 0; j < size; j++)
+        {
+            buffer[j] = rng_next() % 4;
+        }
+        const u32 length = 1 + rng_next() % 40;
+        const u32 start = rng_next() % size;
+        char signature[MAX_PATTERN_LENGTH * 3 + 1];
+        u32 len = 0;
+        for (u32 j = 0; j < length; j++)
+        {
+            if (rng_next() % 4 == 0)
+            {
+                len += sprintf(signature + len, "?? ");
+            }
+            else
+            {
+                u32 byte = (start + j < size && rng_next() % 5) ? buffer[start + j] : rng_next() % 4;
+                len += sprintf(signature + len, "%02X ", byte);
+            }
+        }
+        pattern_t pattern;
+        if (!pattern_compile(signature, &pattern))
+        {
+            continue;
+        }
+        if (pattern_find(&pattern, (u64)buffer, size) != naive_find(&pattern, (u64)buffer, size) && failed++ < 3)
+        {
+            fprintf(stderr, "pattern %s differs\n", signature);
+        }
+    }
+    free(buffer);
+    printf("patterns: %u of %u differ from the naive scan\n", failed, CHECK_CASES);
+    return failed;
+}
+
+/*
+ * @brief Random signature tables against pattern_find() of each entry
+ *
+ * Tables of up to three times SIG_INDEX_THRESHOLD entries, so both the
+ * sweep and the gram index resolve them. Low-entropy buffers make grams
+ * overflow SIG_GRAM_MAX_HITS. Some signatures are not in the buffer.
+ */
+static u32 check_tables(void)
+{
+    u32 failed = 0;
+    for (u32 i = 0; i < TABLE_CASES; i++)
+    {
+        const u32 size = 1024 + rng_next() % 0x40000;
+        const u32 range = i % 2 ? 4 : 256;
+        u8 *buffer = (u8 *)malloc(size);
+        for (u32 j = 0; j < size; j++)
+        {
+            buffer[j] = rng_next() % range;
+        }
+        sig_table_t table = {};
+        const u32 count = 1 + rng_next() % (SIG_INDEX_THRESHOLD * 3);
+        for (u32 j = 0; j < count; j++)
+        {
+            const u32 length = 4 + rng_next() % 24;
+            const u32 start = rng_next() % (size - length);
+            const bool absent = rng_next() % 8 == 0;
+            char signature[MAX_PATTERN_LENGTH * 3 + 1];
+            u32 len = 0;
+            for (u32 k = 0; k < length; k++)
+            {
+                if (rng_next() % 6 == 0)
+                {
+                    len += sprintf(signature + len, "?? ");
+                }
+                else
+                {
+                    len += sprintf(signature + len, "%02X ", absent ? 0xfe : buffer[start + k]);
+                }
+            }
+            sig_table_add(&table, signature);
+        }
+        sig_table_resolve(&table, (u64)buffer, size);
+        for (u32 j = 0; j < table.size; j++)
+        {
+            const sig_entry_t *entry = &table.entry[j];
+            if (entry->valid && entry->result != (u64)pattern_find(&entry->pattern, (u64)buffer, size) && failed++ < 3)
+            {
+                fprintf(stderr, "table %u, %u entries: entry %u differs\n", i, table.size, j);
+            }
+        }
+        sig_table_free(&table);
+        free(buffer);
+    }
+    printf("tables: %u entries of %u tables differ from pattern_find()\n", failed, TABLE_CASES);
+    return failed;
+}
+
+/*
+ * @brief sig_table_resolve_parallel() against sig_table_resolve() for 1 to SCAN_MAX_THREADS threads
+ *
+ * Signatures are taken across the chunk borders the threads split the
+ * buffer at, and some are copied again into a later chunk, so the first
+ * occurrence has to win over the one a later thread finds.
+ */
+static u32 check_parallel(void)
+{
+    u32 failed = 0;
+    for (u32 i = 0; i < PARALLEL_CASES; i++)
+    {
+        const u32 threads = 1 + i % SCAN_MAX_THREADS;
+        const u64 size = SCAN_MIN_CHUNK * (threads + 1) + rng_next() % SCAN_MIN_CHUNK;
+        const u64 chunk = (size + threads - 1) / threads;
+        u8 *buffer = (u8 *)malloc(size);
+        for (u64 j = 0; j < size; j++)
+        {
+            buffer[j] = rng_next() & 0xff;
+        }
+        sig_table_t single = {};
+        sig_table_t parallel = {};
+        const u32 count = 2 + rng_next() % (SIG_INDEX_THRESHOLD * 2);
+        for (u32 j = 0; j < count; j++)
+        {
+            const u32 length = 4 + rng_next() % 28;
+            const u64 border = chunk * (1 + rng_next() % threads);
+            const u64 start = (border < size ? border : size / 2) - rng_next() % length;
+            const u64 room = size - start - length;
+            if (room > 1 && rng_next() % 3 == 0)
+            {
+                memmove(buffer + start + 1 + rng_next() % room, buffer + start, length);
+            }
+            char signature[MAX_PATTERN_LENGTH * 3 + 1];
+            u32 len = 0;
+            for (u32 k = 0; k < length; k++)
+            {
+                len += rng_next() % 6 ? sprintf(signature + len, "%02X ", buffer[start + k]) : sprintf(signature + len, "?? ");
+            }
+            sig_table_add(&single, signature);
+            sig_table_add(&parallel, signature);
+        }
+        sig_table_resolve(&single, (u64)buffer, size);
+        sig_table_resolve_parallel(&parallel, (u64)buffer, size, threads);
+        for (u32 j = 0; j < single.size; j++)
+        {
+            if (single.entry[j].result != parallel.entry[j].result && failed++ < 3)
+            {
+                fprintf(stderr, "%u threads, %lu bytes: entry %u differs\n", threads, size, j);
+            }
+        }
+        sig_table_free(&parallel);
+        sig_table_free(&single);
+        free(buffer);
+    }
+    printf("parallel: %u entries of %u tables differ from one thread\n", failed, PARALLEL_CASES);
+    return failed;
+}
+
+/*
+ * @brief Cold resolve, save, reload and resolve again, as two boots of a title
+ *
+ * The warm resolve runs with the buffer unreadable, so any pattern_find()
+ * or index walk faults. It must report no bytes walked and give the
+ * addresses of the cold resolve, absent signatures included.
+ */
+static u32 check_cache(void)
+{
+    u32 failed = 0;
+    u64 cached = 0;
+    for (u32 i = 0; i < CACHE_CASES; i++)
+    {
+        const u64 size = 0x10000 + (rng_next() % 0x40) * 0x1000;
+        u8 *buffer = (u8 *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        for (u64 j = 0; j < size; j++)
+        {
+            buffer[j] = rng_next() & 0xff;
+        }
+        static char signatures[SIG_INDEX_THRESHOLD * 3][MAX_PATTERN_LENGTH * 3 + 1];
+        const u32 count = 1 + rng_next() % (SIG_INDEX_THRESHOLD * 3);
+        for (u32 j = 0; j < count; j++)
+        {
+            const u32 length = 8 + rng_next() % 24;
+            const u64 start = rng_next() % (size - length);
+            const bool absent = rng_next() % 8 == 0;
+            u32 len = 0;
+            for (u32 k = 0; k < length; k++)
+            {
+                len += rng_next() % 6 ? sprintf(signatures[j] + len, "%02X ", absent ? 0xfe : buffer[start + k]) : sprintf(signatures[j] + len, "?? ");
+            }
+        }
+        const u64 fingerprint = ((u64)rng_next() << 32) | rng_next();
+        unlink(CACHE_PATH);
+
+        sig_table_t cold = {};
+        for (u32 j = 0; j < count; j++)
+        {
+            sig_table_add(&cold, signatures[j]);
+        }
+        sig_cache_t cache;
+        sig_cache_load(&cache, CACHE_PATH, fingerprint);
+        const u32 cold_hits = sig_cache_apply(&cache, &cold, (u64)buffer);
+        sig_table_resolve(&cold, (u64)buffer, size);
+        sig_cache_update(&cache, &cold, (u64)buffer);
+        sig_cache_save(&cache, CACHE_PATH);
+        sig_cache_free(&cache);
+
+        sig_table_t warm = {};
+        for (u32 j = 0; j < count; j++)
+        {
+            sig_table_add(&warm, signatures[j]);
+        }
+        sig_cache_load(&cache, CACHE_PATH, fingerprint);
+        const u32 hits = sig_cache_apply(&cache, &warm, (u64)buffer);
+        sig_cache_free(&cache);
+        mprotect(buffer, size, PROT_NONE);
+        const u64 walked = sig_table_resolve(&warm, (u64)buffer, size);
+        mprotect(buffer, size, PROT_READ | PROT_WRITE);
+
+        bool equal = cold_hits == 0 && hits == warm.size && walked == 0 && warm.size == cold.size;
+        for (u32 j = 0; equal && j < warm.size; j++)
+        {
+            equal = warm.entry[j].resolved && warm.entry[j].result == cold.entry[j].result;
+        }
+        if (!equal && failed++ < 3)
+        {
+            fprintf(stderr, "cache %u: %u of %u cached, %lu bytes walked warm\n", i, hits, warm.size, walked);
+        }
+        cached += hits;
+        sig_table_free(&warm);
+        sig_table_free(&cold);
+        munmap(buffer, size);
+    }
+    unlink(CACHE_PATH);
+    printf("cache: %u of %u warm resolves scanned or differ (%lu signatures cached)\n", failed, CACHE_CASES, cached);
+    return failed;
+}
+
+// Mostly the most common bytes of x86-64 code, a third uniform
+static void fill_code_like(u8 *buffer, u64 size)
+{
+    static const u8 common[] = {0x00, 0x48, 0x8b, 0x89, 0x0f, 0xe8, 0x4c, 0x24, 0x45, 0x85, 0xc0, 0x01};
+    for (u64 i = 0; i < size; i++)
+    {
+        buffer[i] = rng_next() % 3 ? common[rng_next() % sizeof(common)] : rng_next() % 255;
+    }
+}
+
+// Signatures of code in the second half of the buffer, every fifth byte a wildcard
+static void make_signatures(const u8 *buffer, u64 size, char signatures[][MAX_PATTERN_LENGTH * 3 + 1], u32 count)
+{
+    for (u32 i = 0; i < count; i++)
+    {
+        const u64 start = size / 2 + rng_next() % (size / 2 - 64);
+        u32 len = 0;
+        for (u32 j = 0; j < BENCH_PATTERN_LENGTH; j++)
+        {
+            len += (j % 5 == 4) ? sprintf(signatures[i] + len, "?? ") : sprintf(signatures[i] + len, "%02X ", buffer[start + j]);
+        }
+    }
+}
+
+static u32 bench_single(const u8 *buffer, u64 size, char signatures[][MAX_PATTERN_LENGTH * 3 + 1])
+{
+    u32 failed = 0;
+    double start = now_sec();
+    u8 *expected[BENCH_SIGNATURES];
+    for (u32 i = 0; i < BENCH_SIGNATURES; i++)
+    {
+        expected[i] = original_pattern_scan((u64)buffer, size, signatures[i]);
+    }
+    double original_time = now_sec() - start;
+    start = now_sec();
+    for (u32 i = 0; i < BENCH_SIGNATURES; i++)
+    {
+        failed += PatternScan((u64)buffer, size, signatures[i]) != expected[i];
+    }
+    double time = now_sec() - start;
+    const double scanned = 0.75 * size * BENCH_SIGNATURES; // matches sit in the second half
+    printf("PatternScan, %u signatures: %.1f ms (%.2f GB/s), original %.1f ms (%.2f GB/s), %u results differ\n",
+           BENCH_SIGNATURES, time * 1e3, scanned / time / 1e9, original_time * 1e3, scanned / original_time / 1e9, failed);
+    return failed;
+}
+
+/*
+ * @brief TABLE_SIGNATURES signatures resolved three ways
+ *
+ * One table resolved through the gram index, tables one entry short of
+ * SIG_INDEX_THRESHOLD that don't build one, and PatternScan() of each.
+ */
+static u32 bench_table(const u8 *buffer, u64 size, char signatures[][MAX_PATTERN_LENGTH * 3 + 1])
+{
+    u64 expected[TABLE_SIGNATURES];
+    double start = now_sec();
+    for (u32 i = 0; i < TABLE_SIGNATURES; i++)
+    {
+        expected[i] = (u64)PatternScan((u64)buffer, size, signatures[i]);
+    }
+    double linear_time = now_sec() - start;
+
+    u32 failed = 0;
+    sig_table_t table = {};
+    s32 index[TABLE_SIGNATURES];
+    start = now_sec();
+    for (u32 i = 0; i < TABLE_SIGNATURES; i++)
+    {
+        index[i] = sig_table_add(&table, signatures[i]);
+    }
+    sig_table_resolve(&table, (u64)buffer, size);
+    double indexed_time = now_sec() - start;
+    for (u32 i = 0; i < TABLE_SIGNATURES; i++)
+    {
+        failed += table.entry[index[i]].result != expected[i];
+    }
+    sig_table_free(&table);
+
+    start = now_sec();
+    for (u32 first = 0; first < TABLE_SIGNATURES; first += SIG_INDEX_THRESHOLD - 1)
+    {
+        const u32 last = first + SIG_INDEX_THRESHOLD - 1 < TABLE_SIGNATURES ? first + SIG_INDEX_THRESHOLD - 1 : TABLE_SIGNATURES;
+        table = {};
+        for (u32 i = first; i < last; i++)
+        {
+            index[i] = sig_table_add(&table, signatures[i]);
+        }
+        sig_table_resolve(&table, (u64)buffer, size);
+        for (u32 i = first; i < last; i++)
+        {
+            failed += table.entry[index[i]].result != expected[i];
+        }
+        sig_table_free(&table);
+    }
+    double small_time = now_sec() - start;
+    printf("table, %u signatures: gram index %.1f ms, in tables of %u %.1f ms, PatternScan %.1f ms, %u results differ\n",
+           TABLE_SIGNATURES, indexed_time * 1e3, SIG_INDEX_THRESHOLD - 1, small_time * 1e3, linear_time * 1e3, failed);
+    return failed;
+}
+
+// TABLE_SIGNATURES signatures through sig_table_resolve_parallel() at each thread count
+static u32 bench_parallel(const u8 *buffer, u64 size, char signatures[][MAX_PATTERN_LENGTH * 3 + 1])
+{
+    u32 failed = 0;
+    u64 expected[TABLE_SIGNATURES];
+    printf("parallel, %u signatures, %ld CPUs:", TABLE_SIGNATURES, sysconf(_SC_NPROCESSORS_ONLN));
+    for (u32 threads = 1; threads <= SCAN_MAX_THREADS; threads++)
+    {
+        sig_table_t table = {};
+        s32 index[TABLE_SIGNATURES];
+        for (u32 i = 0; i < TABLE_SIGNATURES; i++)
+        {
+            index[i] = sig_table_add(&table, signatures[i]);
+        }
+        double start = now_sec();
+        sig_table_resolve_parallel(&table, (u64)buffer, size, threads);
+        double time = now_sec() - start;
+        for (u32 i = 0; i < TABLE_SIGNATURES; i++)
+        {
+            if (threads == 1)
+            {
+                expected[i] = table.entry[index[i]].result;
+            }
+            failed += table.entry[index[i]].result != expected[i];
+        }
+        sig_table_free(&table);
+        printf(" %u: %.1f ms%s", threads, time * 1e3, threads < SCAN_MAX_THREADS ? "," : "");
+    }
+    printf(", %u results differ\n", failed);
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    const u64 size = (argc > 1 ? strtoull(argv[1], NULL, 10) : 32) << 20;
+    u32 failed = check_patterns() + check_tables() + check_parallel() + check_cache();
+    u8 *buffer = (u8 *)malloc(size);
+    fill_code_like(buffer, size);
+    static char signatures[TABLE_SIGNATURES][MAX_PATTERN_LENGTH * 3 + 1];
+    make_signatures(buffer, size, signatures, TABLE_SIGNATURES);
+    printf("buffer: %lu MB\n", size >> 20);
+    failed += bench_single(buffer, size, signatures);
+    failed += bench_table(buffer, size, signatures);
+    failed += bench_parallel(buffer, size, signatures);
+    free(buffer);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,355 @@
+// Search bench: checks the value search of search.cpp against a scalar
+// reference over random multi-pass runs, regions that turn unreadable and a
+// scan of the whole process, then times the first scan of each type and the
+// narrowing passes on a host buffer.
+// Usage: search_bench [buffer MB]
+
+#include <time.h>
+#include <sys/mman.h>
+#include "search.h"
+#include "memory.h"
+
+#define CHECK_SEEDS 60
+#define CHECK_PASSES 6
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static u64 g_rng = 88172645463325252ull;
+
+static u64 rng_next(void)
+{
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+template <typename T>
+static bool reference_match(search_cmp_t cmp, T cur, T prev, T a, T b)
+{
+    switch (cmp)
+    {
+    case SEARCH_EQ:
+        return cur == a;
+    case SEARCH_RANGE:
+        return cur >= a && cur <= b;
+    case SEARCH_CHANGED:
+        return !(cur == prev);
+    case SEARCH_UNCHANGED:
+        return cur == prev;
+    case SEARCH_INCREASED:
+        return cur > prev;
+    case SEARCH_DECREASED:
+        return cur < prev;
+    default:
+        return true;
+    }
+}
+
+template <typename T>
+static u64 value_bits(T value)
+{
+    u64 bits = 0;
+    memcpy(&bits, &value, sizeof(T));
+    return bits;
+}
+
+// Candidates of the scalar reference, address and previous value
+template <typename T>
+struct reference_t
+{
+    u64 *addr;
+    T *value;
+    u64 count;
+};
+
+/*
+ * @brief One random run: a first scan and CHECK_PASSES narrowing passes, each compared with the reference
+ *
+ * Bytes are drawn from 0-3 so that matches are common and regions stay dense for a few passes.
+ */
+template <typename T>
+static bool check_run(search_type_t type, u64 size, u32 seed)
+{
+    g_rng = 88172645463325252ull + seed;
+    u8 *buffer = (u8 *)malloc(size + 64);
+    u8 *base = buffer + seed % 7;
+    for (u64 i = 0; i < size; i++)
+    {
+        base[i] = rng_next() % 4;
+    }
+    T a, b;
+    memcpy(&a, base + rng_next() % (size / 2), sizeof(T));
+    memcpy(&b, base + rng_next() % (size / 2), sizeof(T));
+    if (b < a)
+    {
+        T t = a;
+        a = b;
+        b = t;
+    }
+    search_t search = {};
+    search_begin(&search, type);
+    const search_cmp_t first = (search_cmp_t)(seed % 3);
+    search_filter_t filter = {first, value_bits(a), value_bits(b)};
+    search_first(&search, (u64)base, size, &filter);
+
+    reference_t<T> ref = {};
+    ref.addr = (u64 *)malloc((size / sizeof(T) + 1) * sizeof(u64));
+    ref.value = (T *)malloc((size / sizeof(T) + 1) * sizeof(T));
+    for (u64 addr = ((u64)base + sizeof(T) - 1) & ~(u64)(sizeof(T) - 1); addr + sizeof(T) <= (u64)base + size; addr += sizeof(T))
+    {
+        T value;
+        memcpy(&value, (const void *)addr, sizeof(T));
+        if (reference_match<T>(first, value, value, a, b))
+        {
+            ref.addr[ref.count] = addr;
+            ref.value[ref.count++] = value;
+        }
+    }
+    bool ok = search.count == ref.count;
+    u64 *results = (u64 *)malloc((ref.count + 1) * sizeof(u64));
+    for (u32 pass = 0; ok && pass < CHECK_PASSES; pass++)
+    {
+        // heavy changes first, then few so the regions turn sparse
+        const u32 per_mille = pass < 3 ? 300 : 20;
+        for (u64 i = 0; i < size; i++)
+        {
+            if (rng_next() % 1000 < per_mille)
+            {
+                base[i] = rng_next() % 4;
+            }
+        }
+        const search_cmp_t cmp = (search_cmp_t)(SEARCH_EQ + rng_next() % 6);
+        filter = {cmp, value_bits(a), value_bits(b)};
+        search_next(&search, &filter);
+        u64 kept = 0;
+        for (u64 i = 0; i < ref.count; i++)
+        {
+            T value;
+            memcpy(&value, (const void *)ref.addr[i], sizeof(T));
+            if (reference_match<T>(cmp, value, ref.value[i], a, b))
+            {
+                ref.addr[kept] = ref.addr[i];
+                ref.value[kept++] = value;
+            }
+        }
+        ref.count = kept;
+        u32 found = search_results(&search, results, (u32)ref.count);
+        ok = found == ref.count && search.count == ref.count && !memcmp(results, ref.addr, found * sizeof(u64));
+        if (!ok)
+        {
+            fprintf(stderr, "type %d seed %u pass %u cmp %d: %lu candidates, reference %lu\n", type, seed, pass, cmp,
+                    search.count, ref.count);
+        }
+    }
+    free(results);
+    free(ref.value);
+    free(ref.addr);
+    search_free(&search);
+    free(buffer);
+    return ok;
+}
+
+static u32 check_all(void)
+{
+    u32 failed = 0;
+    u32 runs = 0;
+    for (u32 seed = 0; seed < CHECK_SEEDS; seed++)
+    {
+        const u64 size = 1000 + (seed * 7919) % 200000;
+        failed += !check_run<u8>(SEARCH_U8, size, seed);
+        failed += !check_run<u16>(SEARCH_U16, size, seed);
+        failed += !check_run<u32>(SEARCH_U32, size, seed);
+        failed += !check_run<u64>(SEARCH_U64, size, seed);
+        failed += !check_run<f32>(SEARCH_F32, size, seed);
+        failed += !check_run<f64>(SEARCH_F64, size, seed);
+        runs += 6;
+    }
+    printf("random runs: %u of %u differ from the scalar reference\n", failed, runs);
+    return failed;
+}
+
+/*
+ * @brief Regions that can't be read, from the start or after the first scan
+ *
+ * Both must be dropped without faulting, in dense and in sparse storage.
+ */
+static u32 check_unreadable(void)
+{
+    const u64 size = 4 * MEM_PAGE_SIZE;
+    u8 *buffer = (u8 *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    u32 failed = 0;
+    search_filter_t filter = {SEARCH_ANY, 0, 0};
+    search_t search = {};
+    search_begin(&search, SEARCH_U32);
+    mprotect(buffer, size, PROT_NONE);
+    failed += search_first(&search, (u64)buffer, size, &filter) != 0 || search.region_count != 0;
+    mprotect(buffer, size, PROT_READ | PROT_WRITE);
+    for (u32 sparse = 0; sparse < 2; sparse++)
+    {
+        memset(buffer, 0, size);
+        buffer[100] = sparse;
+        filter = {sparse ? SEARCH_EQ : SEARCH_ANY, 1, 0};
+        search_begin(&search, SEARCH_U8);
+        failed += search_first(&search, (u64)buffer, size, &filter) == 0 || search.region_count != 1 ||
+                  (search.region[0].offsets != nullptr) != (sparse != 0);
+        mprotect(buffer, size, PROT_NONE);
+        filter = {SEARCH_UNCHANGED, 0, 0};
+        failed += search_next(&search, &filter) != 0 || search.region_count != 0;
+        mprotect(buffer, size, PROT_READ | PROT_WRITE);
+        search_free(&search);
+    }
+    munmap(buffer, size);
+    printf("unreadable: %u of 3 regions not dropped\n", failed);
+    return failed;
+}
+
+/*
+ * @brief Process scan for a marker planted in a buffer
+ *
+ * Every planted copy must be found and no candidate may lie in the
+ * candidate storage of the search itself.
+ */
+static u32 check_process(void)
+{
+    const u32 planted = 500;
+    const u64 size = 64 * MEM_PAGE_SIZE;
+    u64 *buffer = (u64 *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    const u64 marker = rng_next() | 1;
+    for (u32 i = 0; i < planted; i++)
+    {
+        buffer[(i * 2654435761u) % (size / 8)] = marker;
+    }
+    search_t search = {};
+    search_begin(&search, SEARCH_U64);
+    search_filter_t filter = {SEARCH_EQ, marker, 0};
+    search_first_process(&search, &filter);
+    u64 *results = (u64 *)malloc(search.count * sizeof(u64) + 1);
+    const u32 count = search_results(&search, results, (u32)search.count);
+    u32 found = 0;
+    u32 own = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        found += results[i] >= (u64)buffer && results[i] < (u64)buffer + size;
+        for (u32 j = 0; j < search.region_count; j++)
+        {
+            const search_region_t *region = &search.region[j];
+            const u8 *values = region->values;
+            const u64 values_size = region->offsets ? region->count * 8 : region->size;
+            own += results[i] >= (u64)values && results[i] < (u64)values + values_size;
+        }
+    }
+    printf("process: %u of %u planted found, %u candidates in its own storage, %u elsewhere\n", found, planted, own,
+           count - found - own);
+    free(results);
+    search_free(&search);
+    munmap(buffer, size);
+    return (found != planted) + own;
+}
+
+// plain loop the compiler may not vectorize, the baseline for the lane compares
+__attribute__((noinline, optimize("no-tree-vectorize"))) static u64 scalar_count_u32(const u32 *values, u64 count, u32 value)
+{
+    u64 found = 0;
+    for (u64 i = 0; i < count; i++)
+    {
+        found += values[i] == value;
+    }
+    return found;
+}
+
+static void bench_first(u8 *buffer, u64 size)
+{
+    double start = now_sec();
+    u64 found = scalar_count_u32((const u32 *)buffer, size / 4, 12345);
+    double seconds = now_sec() - start;
+    printf("scalar u32 count: %.2f GB/s, %lu found\n", size / seconds / 1e9, found);
+
+    static const char *names[] = {"u8", "u16", "u32", "u64", "f32", "f64"};
+    for (u32 type = SEARCH_U8; type <= SEARCH_F64; type++)
+    {
+        search_t search = {};
+        search_begin(&search, (search_type_t)type);
+        search_filter_t filter = {SEARCH_EQ, 12345, 0};
+        search_parse_value((search_type_t)type, "12345", &filter.a);
+        start = now_sec();
+        search_first(&search, (u64)buffer, size, &filter);
+        seconds = now_sec() - start;
+        printf("first eq %s: %.2f GB/s, %lu candidates, %lu bytes held\n", names[type], size / seconds / 1e9,
+               search.count, search.memory);
+        search_free(&search);
+    }
+}
+
+// dense range scan that keeps about half the values, then narrowing passes until the regions turn sparse
+static void bench_narrow(u8 *buffer, u64 size)
+{
+    search_t search = {};
+    search_begin(&search, SEARCH_U32);
+    search_filter_t filter = {SEARCH_RANGE, 0, 0x7fffffff};
+    double start = now_sec();
+    search_first(&search, (u64)buffer, size, &filter);
+    double seconds = now_sec() - start;
+    printf("first range u32: %.2f GB/s, %lu candidates, %lu MB held\n", size / seconds / 1e9, search.count,
+           search.memory >> 20);
+
+    u32 *values = (u32 *)buffer;
+    for (u64 i = 0; i < size / 4; i += 3)
+    {
+        values[i]++;
+    }
+    filter = {SEARCH_INCREASED, 0, 0};
+    start = now_sec();
+    search_next(&search, &filter);
+    seconds = now_sec() - start;
+    printf("next increased (dense): %.2f GB/s, %lu left, %lu MB held\n", size / seconds / 1e9, search.count,
+           search.memory >> 20);
+
+    for (u64 i = 0; i < size / 4; i += 3 * 1024)
+    {
+        values[i]++;
+    }
+    start = now_sec();
+    search_next(&search, &filter);
+    seconds = now_sec() - start;
+    printf("next increased: %.3f ms, %lu left, %lu KB held (%s)\n", seconds * 1e3, search.count, search.memory >> 10,
+           search.region_count && search.region[0].offsets ? "sparse" : "dense");
+
+    filter = {SEARCH_UNCHANGED, 0, 0};
+    start = now_sec();
+    search_next(&search, &filter);
+    seconds = now_sec() - start;
+    printf("next unchanged: %.3f ms, %lu left\n", seconds * 1e3, search.count);
+    search_free(&search);
+}
+
+int main(int argc, char **argv)
+{
+    const u64 size = (argc > 1 ? strtoull(argv[1], NULL, 10) : 256) << 20;
+    u32 failed = check_all() + check_unreadable() + check_process();
+    u8 *buffer = (u8 *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (buffer == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+    u64 *words = (u64 *)buffer;
+    for (u64 i = 0; i < size / 8; i++)
+    {
+        words[i] = rng_next();
+    }
+    for (u64 i = 0; i < 1000; i++)
+    {
+        ((u32 *)buffer)[(i * 2654435761u) % (size / 4)] = 12345;
+    }
+    printf("buffer: %lu MB\n", size >> 20);
+    bench_first(buffer, size);
+    bench_narrow(buffer, size);
+    munmap(buffer, size);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,449 @@
+// Write bench: checks the write batches of patch.cpp against the original
+// one call per write patch_data1(), then counts and times the
+// sys_sdk_proc_rw() calls of both on a generated title, and times the
+// proc_rw and direct write backends against each other.
+// sys_sdk_proc_rw() is wrapped with --wrap, see the Makefile, and goes
+// through /proc/self/mem so every call is a kernel round trip that can write
+// read-only pages, like proc_rw on the console.
+// Usage: write_bench [patch lines]
+
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "patch.h"
+
+#define CHECK_SEEDS 300
+#define CHECK_SIZE 0x10000
+#define BENCH_SIZE 0x400000
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static u64 g_rng = 88172645463325252ull;
+
+static u32 rng_next(void)
+{
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return (u32)(g_rng >> 32);
+}
+
+static s32 g_mem_fd = -1;
+static u64 g_proc_rw_calls = 0;
+
+extern "C" int __wrap_sys_sdk_proc_rw(struct proc_rw *rw)
+{
+    g_proc_rw_calls++;
+    ssize_t done = rw->write_flags ? pwrite(g_mem_fd, rw->data, rw->length, (off_t)rw->address)
+                                   : pread(g_mem_fd, rw->data, rw->length, (off_t)rw->address);
+    return done == (ssize_t)rw->length ? 0 : -1;
+}
+
+// One patch line of a title, as the xml gives it
+struct line_t
+{
+    const char *type;
+    u64 addr;
+    char value[160];
+    u32 source_size; // mask_jump32
+    u64 jump_target; // mask_jump32
+};
+
+/*
+ * @brief Lines of a title over `size` bytes at `base`
+ *
+ * Most lines follow the previous one closely, as patches of neighbouring
+ * instructions do, some overlap it. Code caves are taken from the last
+ * eighth, one after the other.
+ */
+static line_t *make_title(u64 base, u64 size, u32 count)
+{
+    static const char *types[] = {"bytes", "bytes", "bytes", "bytes", "bytes32", "bytes32", "byte",
+                                  "bytes16", "float32", "utf8", "utf16", "utf16", "mask_jump32", "bytes64"};
+    line_t *lines = (line_t *)calloc(count, sizeof(line_t));
+    const u64 code_size = size - size / 8;
+    u64 next = base + rng_next() % code_size;
+    u64 cave = base + code_size;
+    for (u32 i = 0; i < count; i++)
+    {
+        line_t *line = &lines[i];
+        line->type = types[rng_next() % (sizeof(types) / sizeof(types[0]))];
+        u32 len = 0;
+        if (!strcmp(line->type, "bytes") || !strcmp(line->type, "mask_jump32"))
+        {
+            const u32 bytes = 1 + rng_next() % 16;
+            for (u32 j = 0; j < bytes; j++)
+            {
+                len += sprintf(line->value + len, "%02X", rng_next() & 0xff);
+            }
+        }
+        else if (!strcmp(line->type, "utf8") || !strcmp(line->type, "utf16"))
+        {
+            const u32 chars = 4 + rng_next() % 28;
+            for (u32 j = 0; j < chars; j++)
+            {
+                line->value[len++] = 'a' + rng_next() % 26;
+            }
+        }
+        else if (!strcmp(line->type, "float32"))
+        {
+            sprintf(line->value, "%u.5", rng_next() % 1000);
+        }
+        else
+        {
+            sprintf(line->value, "0x%x", rng_next());
+        }
+        if (!strcmp(line->type, "mask_jump32"))
+        {
+            line->source_size = 5 + rng_next() % 8;
+            line->jump_target = cave;
+            cave += strlen(line->value) / 2 + 5;
+        }
+        line->addr = next;
+        // the longest value, utf16 of 31 characters, takes 64 bytes
+        if (line->addr + 80 > base + code_size)
+        {
+            line->addr = base + rng_next() % (code_size - 80);
+        }
+        next = rng_next() % 4 ? line->addr + rng_next() % 24 : base + rng_next() % (code_size - 80);
+    }
+    return lines;
+}
+
+typedef void (*write_fn_t)(u64 addr, void *data, u64 length);
+
+/*
+ * @brief patch_data1() before the write batches, from patch.cpp
+ *
+ * Every write is a call of `write`, utf16 writes each character and
+ * mask_jump32 each NOP byte.
+ */
+static void original_patch_data1(write_fn_t write, const line_t *line)
+{
+    const u64 patch_type = djb2_hash(line->type);
+    if (patch_type == djb2_hash("utf16"))
+    {
+        u64 addr = line->addr;
+        for (u32 i = 0; line->value[i]; i++)
+        {
+            u8 value_[2] = {(u8)line->value[i], 0x00};
+            write(addr, value_, sizeof(value_));
+            addr += 2;
+        }
+        u8 value_[2] = {0x00, 0x00};
+        write(addr, value_, sizeof(value_));
+        return;
+    }
+    byte_buffer_t value = {};
+    u32 size = 0;
+    patch_value_decode(patch_type, line->value, &value, &size);
+    if (patch_type == djb2_hash("mask_jump32"))
+    {
+        const u64 addr = line->addr;
+        const u64 code_cave_end = line->jump_target + size;
+        for (u32 i = 0; i < line->source_size; i++)
+        {
+            u8 nop_byte[] = {0x90};
+            write(addr + i, nop_byte, sizeof(nop_byte));
+        }
+        u8 jump_32[] = {0xe9, 0x00, 0x00, 0x00, 0x00};
+        s32 target_jmp = (s32)(line->jump_target - addr - 5);
+        s32 target_return = (s32)(addr) - (code_cave_end);
+        write(line->jump_target, value.data, size);
+        write(addr, jump_32, sizeof(jump_32));
+        write(addr + 1, &target_jmp, sizeof(target_jmp));
+        write(code_cave_end, jump_32, sizeof(jump_32));
+        write(code_cave_end + 1, &target_return, sizeof(target_return));
+    }
+    else
+    {
+        write(line->addr, value.data, size);
+    }
+    buffer_free(&value);
+}
+
+// Queue the lines the way get_key_init() does
+static void queue_title(write_batch_t *batch, const line_t *lines, u32 count)
+{
+    byte_buffer_t value = {};
+    for (u32 i = 0; i < count; i++)
+    {
+        const u64 patch_type = djb2_hash(lines[i].type);
+        u32 size = 0;
+        value.size = 0;
+        if (patch_value_decode(patch_type, lines[i].value, &value, &size))
+        {
+            batch->tag = i + 1;
+            patch_data1(batch, patch_type, lines[i].addr, value.data, size, lines[i].source_size, lines[i].jump_target);
+        }
+    }
+    buffer_free(&value);
+}
+
+// Writes of the reference go to a copy of the target, `g_shadow_delta` bytes away
+static u64 g_shadow_delta = 0;
+
+static void shadow_write(u64 addr, void *data, u64 length)
+{
+    memcpy((void *)(addr + g_shadow_delta), data, length);
+}
+
+static u8 *map_target(u64 size)
+{
+    u8 *target = (u8 *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    for (u64 i = 0; i < size; i++)
+    {
+        target[i] = rng_next() & 0xff;
+    }
+    // game code is not writable
+    mprotect(target, size, PROT_READ);
+    return target;
+}
+
+/*
+ * @brief Random titles, batched writes against the original ones
+ *
+ * Each title is also flushed with an undo log and restored, which must
+ * give back the bytes from before. Half of the titles use the direct
+ * backend, which must not call proc_rw without an undo log and must leave
+ * the protection as it was. Some targets have a writable upper half, so
+ * spans cross from one mapping into the next.
+ */
+static u32 check_titles(void)
+{
+    u32 failed = 0;
+    for (u32 seed = 0; seed < CHECK_SEEDS; seed++)
+    {
+        g_rng = 88172645463325252ull + seed;
+        u8 *target = map_target(CHECK_SIZE);
+        const bool split = seed % 8 >= 4;
+        if (split)
+        {
+            mprotect(target + CHECK_SIZE / 2, CHECK_SIZE / 2, PROT_READ | PROT_WRITE);
+        }
+        u8 *original = (u8 *)malloc(CHECK_SIZE);
+        u8 *expected = (u8 *)malloc(CHECK_SIZE);
+        memcpy(original, target, CHECK_SIZE);
+        memcpy(expected, target, CHECK_SIZE);
+        const u32 count = 1 + rng_next() % 400;
+        line_t *lines = make_title((u64)target, CHECK_SIZE, count);
+        g_shadow_delta = (u64)expected - (u64)target;
+        for (u32 i = 0; i < count; i++)
+        {
+            original_patch_data1(shadow_write, &lines[i]);
+        }
+        undo_log_t undo = {};
+        write_batch_t batch = {};
+        const bool with_undo = seed % 2;
+        batch.undo = with_undo ? &undo : nullptr;
+        batch.mode = seed % 4 < 2 ? WRITE_MODE_PROC_RW : WRITE_MODE_DIRECT;
+        queue_title(&batch, lines, count);
+        g_proc_rw_calls = 0;
+        write_batch_flush(&batch);
+        bool ok = !memcmp(target, expected, CHECK_SIZE);
+        if (batch.mode == WRITE_MODE_DIRECT)
+        {
+            u64 region_start = 0, region_end = 0;
+            s32 prot = 0, upper_prot = 0;
+            ok = ok && (with_undo || !g_proc_rw_calls) &&
+                 mem_query_protection((u64)target, &region_start, &region_end, &prot) && prot == MEM_PROT_READ &&
+                 mem_query_protection((u64)target + CHECK_SIZE / 2, &region_start, &region_end, &upper_prot) &&
+                 upper_prot == (split ? MEM_PROT_READ | MEM_PROT_WRITE : MEM_PROT_READ);
+        }
+        bool restored = false;
+        if (ok && with_undo)
+        {
+            // the flush cleared the batch
+            for (u32 tag = count; tag > 0; tag--)
+            {
+                undo_log_restore(&undo, &batch, tag);
+            }
+            write_batch_flush(&batch);
+            ok = !memcmp(target, original, CHECK_SIZE);
+            restored = true;
+        }
+        if (!ok)
+        {
+            fprintf(stderr, "seed %u, %u lines: bytes differ%s\n", seed, count, restored ? " after undo" : "");
+            failed++;
+        }
+        undo_log_free(&undo);
+        free(lines);
+        free(expected);
+        free(original);
+        munmap(target, CHECK_SIZE);
+    }
+    printf("titles: %u of %u differ from the original writes\n", failed, CHECK_SEEDS);
+    return failed;
+}
+
+/*
+ * @brief Conflict counts of overlapping writes
+ *
+ * Patches are told apart by tag: two entries with the same name still
+ * conflict, the NOP fill and jump one mask_jump32 writes over each other
+ * don't. Each op reports every other tag it overlaps once.
+ */
+static u32 check_conflicts(void)
+{
+    struct conflict_case_t
+    {
+        const char *owner[3];
+        u32 tag[3];
+        u32 offset[3];
+        u32 size[3];
+        u32 conflicts;
+    };
+    static const conflict_case_t cases[] = {
+        {{"60 FPS", "60 FPS", "60 FPS"}, {1, 2, 2}, {0, 4, 64}, {8, 8, 4}, 1},
+        {{"Skip intro", "Skip intro", "Skip intro"}, {3, 3, 3}, {0, 0, 2}, {8, 5, 4}, 0},
+        {{"A", "B", "B"}, {1, 2, 2}, {0, 2, 4}, {16, 2, 2}, 2},
+        {{"A", "B", "C"}, {1, 2, 3}, {0, 2, 4}, {16, 8, 2}, 3},
+        {{"A", "B", "A"}, {1, 2, 1}, {0, 16, 32}, {8, 8, 8}, 0},
+    };
+    u8 *target = map_target(0x1000);
+    u32 failed = 0;
+    for (u32 i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        const conflict_case_t *c = &cases[i];
+        write_batch_t batch = {};
+        batch.mode = WRITE_MODE_PROC_RW;
+        for (u32 j = 0; j < 3; j++)
+        {
+            u8 data[16];
+            memset(data, j, sizeof(data));
+            batch.owner = c->owner[j];
+            batch.tag = c->tag[j];
+            write_batch_add(&batch, (u64)target + c->offset[j], data, c->size[j]);
+        }
+        write_batch_flush(&batch);
+        if (batch.conflicts != c->conflicts)
+        {
+            fprintf(stderr, "conflict case %u: %u conflicts, expected %u\n", i, batch.conflicts, c->conflicts);
+            failed++;
+        }
+    }
+    munmap(target, 0x1000);
+    printf("conflicts: %u of %lu cases counted wrong\n", failed, sizeof(cases) / sizeof(cases[0]));
+    return failed;
+}
+
+// Reset the target to `bytes`
+static void reset_target(u8 *target, const u8 *bytes, u64 size)
+{
+    mprotect(target, size, PROT_READ | PROT_WRITE);
+    memcpy(target, bytes, size);
+    mprotect(target, size, PROT_READ);
+}
+
+static u32 bench_batch(u32 count)
+{
+    u8 *target = map_target(BENCH_SIZE);
+    line_t *lines = make_title((u64)target, BENCH_SIZE, count);
+    u8 *initial = (u8 *)malloc(BENCH_SIZE);
+    u8 *expected = (u8 *)malloc(BENCH_SIZE);
+    memcpy(initial, target, BENCH_SIZE);
+
+    g_proc_rw_calls = 0;
+    double start = now_sec();
+    for (u32 i = 0; i < count; i++)
+    {
+        original_patch_data1(sys_proc_rw, &lines[i]);
+    }
+    double original_time = now_sec() - start;
+    u64 original_calls = g_proc_rw_calls;
+    memcpy(expected, target, BENCH_SIZE);
+    reset_target(target, initial, BENCH_SIZE);
+
+    write_batch_t batch = {};
+    g_proc_rw_calls = 0;
+    start = now_sec();
+    queue_title(&batch, lines, count);
+    const u32 queued = batch.size;
+    write_batch_flush(&batch);
+    double time = now_sec() - start;
+    const bool equal = !memcmp(target, expected, BENCH_SIZE);
+    printf("title, %u lines: %u writes queued, %lu proc_rw calls in %.2f ms, original %lu calls in %.2f ms, bytes %s\n",
+           count, queued, g_proc_rw_calls, time * 1e3, original_calls, original_time * 1e3, equal ? "equal" : "differ");
+    free(expected);
+    free(initial);
+    free(lines);
+    munmap(target, BENCH_SIZE);
+    return !equal;
+}
+
+/*
+ * @brief The flush of one title with each backend
+ *
+ * Without an undo log both make the same spans, so the difference is one
+ * proc_rw call per span against a protection query, two mprotect calls
+ * and a memcpy. Writable pages skip the mprotect calls.
+ */
+static u32 bench_direct(u32 count)
+{
+    u8 *target = map_target(BENCH_SIZE);
+    line_t *lines = make_title((u64)target, BENCH_SIZE, count);
+    u8 *initial = (u8 *)malloc(BENCH_SIZE);
+    u8 *expected = (u8 *)malloc(BENCH_SIZE);
+    memcpy(initial, target, BENCH_SIZE);
+    static const char *names[] = {"proc_rw", "direct", "direct, writable"};
+    double times[3] = {0, 0, 0};
+    u32 spans = 0;
+    u32 failed = 0;
+    for (u32 backend = 0; backend < 3; backend++)
+    {
+        reset_target(target, initial, BENCH_SIZE);
+        if (backend == 2)
+        {
+            mprotect(target, BENCH_SIZE, PROT_READ | PROT_WRITE);
+        }
+        write_batch_t batch = {};
+        batch.mode = backend ? WRITE_MODE_DIRECT : WRITE_MODE_PROC_RW;
+        queue_title(&batch, lines, count);
+        g_proc_rw_calls = 0;
+        double start = now_sec();
+        spans = write_batch_flush(&batch);
+        times[backend] = now_sec() - start;
+        if (!backend)
+        {
+            memcpy(expected, target, BENCH_SIZE);
+        }
+        else if (memcmp(target, expected, BENCH_SIZE) || g_proc_rw_calls)
+        {
+            fprintf(stderr, "%s: bytes differ or %lu proc_rw calls\n", names[backend], g_proc_rw_calls);
+            failed++;
+        }
+    }
+    printf("flush, %u spans:", spans);
+    for (u32 backend = 0; backend < 3; backend++)
+    {
+        printf(" %s %.2f ms (%.2f us a span)%s", names[backend], times[backend] * 1e3, times[backend] * 1e6 / spans,
+               backend < 2 ? "," : "\n");
+    }
+    free(expected);
+    free(initial);
+    free(lines);
+    munmap(target, BENCH_SIZE);
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    const u32 count = argc > 1 ? (u32)atoi(argv[1]) : 2000;
+    g_mem_fd = open("/proc/self/mem", O_RDWR);
+    if (g_mem_fd < 0)
+    {
+        perror("/proc/self/mem");
+        return 1;
+    }
+    u32 failed = check_titles() + check_conflicts();
+    failed += bench_batch(count);
+    failed += bench_direct(count);
+    close(g_mem_fd);
+    return failed ? 1 : 0;
+}
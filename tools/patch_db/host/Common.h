@@ -0,0 +1,28 @@
+// Host stand-in for the GoldHEN SDK's Common.h, enough for the game_patch
+// sources the patch database tool is built from.
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "GoldHEN.h"
+
+#define STRINGIFY(x) #x
+
+// libkernel file calls on top of the host's, flags as the plugin passes them
+#ifdef __cplusplus
+extern "C" {
+#endif
+int sceKernelOpen(const char *path, int flags, int mode);
+int sceKernelClose(int fd);
+int64_t sceKernelLseek(int fd, int64_t offset, int whence);
+int64_t sceKernelRead(int fd, void *data, size_t size);
+int64_t sceKernelWrite(int fd, const void *data, size_t size);
+#ifdef __cplusplus
+}
+#endif
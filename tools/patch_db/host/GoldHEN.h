@@ -0,0 +1,23 @@
+// Host stand-in for the GoldHEN SDK's GoldHEN.h, see host.cpp
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct proc_rw
+{
+    uint64_t address;
+    void *data;
+    uint64_t length;
+    uint64_t write_flags;
+};
+
+int sys_sdk_proc_rw(struct proc_rw *rw);
+void klog(const char *fmt, ...);
+void hex_dump(void *data, uint64_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,62 @@
+#include "Common.h"
+#include <fcntl.h>
+
+// Kernel log goes to stderr, only with -v
+bool g_verbose = false;
+
+extern "C" void klog(const char *fmt, ...)
+{
+    if (!g_verbose)
+    {
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+extern "C" void hex_dump(void *data, uint64_t size)
+{
+    for (uint64_t i = 0; g_verbose && i < size; i++)
+    {
+        fprintf(stderr, "%02x ", ((const uint8_t *)data)[i]);
+    }
+}
+
+// the tool never writes process memory
+extern "C" int sys_sdk_proc_rw(struct proc_rw *rw)
+{
+    return -1;
+}
+
+// Orbis open flags are FreeBSD's
+extern "C" int sceKernelOpen(const char *path, int flags, int mode)
+{
+    int host_flags = flags & 3;
+    host_flags |= (flags & 0x008) ? O_APPEND : 0;
+    host_flags |= (flags & 0x200) ? O_CREAT : 0;
+    host_flags |= (flags & 0x400) ? O_TRUNC : 0;
+    const int fd = open(path, host_flags, mode);
+    return fd < 0 ? -1 : fd;
+}
+
+extern "C" int sceKernelClose(int fd)
+{
+    return close(fd);
+}
+
+extern "C" int64_t sceKernelLseek(int fd, int64_t offset, int whence)
+{
+    return lseek(fd, offset, whence);
+}
+
+extern "C" int64_t sceKernelRead(int fd, void *data, size_t size)
+{
+    return read(fd, data, size);
+}
+
+extern "C" int64_t sceKernelWrite(int fd, const void *data, size_t size)
+{
+    return write(fd, data, size);
+}
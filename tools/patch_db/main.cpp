@@ -0,0 +1,279 @@
+// Patch DB: compiles a directory of patch xml files into one patch database.
+// Runs on a PC, built from the game_patch sources so the output matches what
+// the plugin would compile itself.
+// Usage: patch_db [-v] [-j threads] <xml dir> <output .ghdb>
+// Copy the output to /data/GoldHEN/patches/patches.ghdb
+
+#include <dirent.h>
+#include <time.h>
+#include "crc32c.h"
+#include "ghdb.h"
+#include "ghp.h"
+#include "thread.h"
+
+#define PATCH_DB_MAX_THREADS 64
+
+extern bool g_verbose;
+
+struct compile_job_t
+{
+    char titleid[16];
+    char path[MAX_PATH_];
+    u8 *ghp;
+    u64 ghp_size;
+    u64 xml_size;
+    u32 xml_crc;
+    bool ok;
+};
+
+struct compile_queue_t
+{
+    compile_job_t *job;
+    u32 count;
+    u32 next; // next job to take, shared by the workers
+};
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool read_text_file(const char *path, char **out, u64 *out_size)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *data = (char *)malloc(size + 1);
+    bool ok = size >= 0 && fread(data, 1, size, file) == (size_t)size;
+    fclose(file);
+    if (!ok)
+    {
+        free(data);
+        return false;
+    }
+    data[size] = '\0';
+    *out = data;
+    *out_size = size;
+    return true;
+}
+
+static void compile_job(compile_job_t *job)
+{
+    char *xml = nullptr;
+    if (!read_text_file(job->path, &xml, &job->xml_size))
+    {
+        fprintf(stderr, "%s: could not be read\n", job->path);
+        return;
+    }
+    job->xml_crc = crc32c(0, xml, job->xml_size);
+    // the settings hash takes the xml path on the console
+    char device_path[MAX_PATH_];
+    snprintf(device_path, sizeof(device_path), GHDB_XML_PATH, job->titleid);
+    job->ok = ghp_compile(xml, device_path, NULL, NULL, job->xml_size, 0, &job->ghp, &job->ghp_size);
+    if (!job->ok)
+    {
+        fprintf(stderr, "%s: could not be parsed\n", job->path);
+    }
+    free(xml);
+}
+
+static void *compile_worker(void *arg)
+{
+    compile_queue_t *queue = (compile_queue_t *)arg;
+    u32 i = 0;
+    while ((i = __atomic_fetch_add(&queue->next, 1, __ATOMIC_RELAXED)) < queue->count)
+    {
+        compile_job(&queue->job[i]);
+    }
+    return NULL;
+}
+
+static int job_cmp(const void *a, const void *b)
+{
+    return ghdb_title_cmp(((const compile_job_t *)a)->titleid, ((const compile_job_t *)b)->titleid);
+}
+
+// list <titleid>.xml files, names that don't fit a title id are skipped
+static u32 list_jobs(const char *dir_path, compile_job_t **jobs)
+{
+    DIR *dir = opendir(dir_path);
+    if (!dir)
+    {
+        return 0;
+    }
+    u32 count = 0;
+    struct dirent *dent = nullptr;
+    while ((dent = readdir(dir)))
+    {
+        const char *name = dent->d_name;
+        size_t len = strlen(name);
+        if (len < 5 || strcasecmp(name + len - 4, ".xml"))
+        {
+            continue;
+        }
+        if (len - 4 >= sizeof((*jobs)->titleid))
+        {
+            fprintf(stderr, "%s: name is too long for a title id, skipped\n", name);
+            continue;
+        }
+        if ((count % 256) == 0)
+        {
+            *jobs = (compile_job_t *)realloc(*jobs, (256 + count) * sizeof(compile_job_t));
+        }
+        compile_job_t *job = &(*jobs)[count++];
+        memset(job, 0, sizeof(*job));
+        memcpy(job->titleid, name, len - 4);
+        snprintf(job->path, sizeof(job->path), "%s/%s", dir_path, name);
+    }
+    closedir(dir);
+    return count;
+}
+
+static bool write_database(const char *path, const compile_job_t *jobs, u32 count, u32 *written)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+    u32 titles = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        titles += jobs[i].ok;
+    }
+    ghdb_header_t header = {};
+    header.magic = GHDB_MAGIC;
+    header.version = GHDB_VERSION;
+    header.ghp_version = GHP_VERSION;
+    header.title_count = titles;
+    header.index_offset = sizeof(header);
+    header.data_offset = (header.index_offset + titles * sizeof(ghdb_title_t) + GHDB_ALIGN - 1) & ~(u64)(GHDB_ALIGN - 1);
+
+    ghdb_title_t *index = (ghdb_title_t *)calloc(titles + 1, sizeof(ghdb_title_t));
+    u64 offset = header.data_offset;
+    u32 n = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        if (!jobs[i].ok)
+        {
+            continue;
+        }
+        memcpy(index[n].titleid, jobs[i].titleid, sizeof(index[n].titleid));
+        index[n].offset = offset;
+        index[n].size = jobs[i].ghp_size;
+        index[n].xml_size = jobs[i].xml_size;
+        index[n].xml_crc = jobs[i].xml_crc;
+        offset = (offset + jobs[i].ghp_size + GHDB_ALIGN - 1) & ~(u64)(GHDB_ALIGN - 1);
+        n++;
+    }
+    static const u8 padding[GHDB_ALIGN] = {};
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(index, sizeof(ghdb_title_t), titles, file) == titles &&
+              fwrite(padding, 1, header.data_offset - header.index_offset - titles * sizeof(ghdb_title_t), file) ==
+                  header.data_offset - header.index_offset - titles * sizeof(ghdb_title_t);
+    for (u32 i = 0; ok && i < count; i++)
+    {
+        if (!jobs[i].ok)
+        {
+            continue;
+        }
+        u64 pad = (GHDB_ALIGN - (jobs[i].ghp_size % GHDB_ALIGN)) % GHDB_ALIGN;
+        ok = fwrite(jobs[i].ghp, 1, jobs[i].ghp_size, file) == jobs[i].ghp_size &&
+             fwrite(padding, 1, pad, file) == pad;
+    }
+    free(index);
+    ok = (fclose(file) == 0) && ok;
+    *written = titles;
+    return ok;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: patch_db [-v] [-j threads] <xml dir> <output .ghdb>\n");
+}
+
+int main(int argc, char **argv)
+{
+    u32 threads = (u32)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *xml_dir = nullptr;
+    const char *out_path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-v"))
+        {
+            g_verbose = true;
+        }
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+        {
+            threads = strtoul(argv[++i], NULL, 10);
+        }
+        else if (!xml_dir)
+        {
+            xml_dir = argv[i];
+        }
+        else if (!out_path)
+        {
+            out_path = argv[i];
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (!xml_dir || !out_path)
+    {
+        usage();
+        return 1;
+    }
+    threads = threads < 1 ? 1 : threads > PATCH_DB_MAX_THREADS ? PATCH_DB_MAX_THREADS : threads;
+
+    double start = now_sec();
+    compile_queue_t queue = {};
+    queue.count = list_jobs(xml_dir, &queue.job);
+    if (!queue.count)
+    {
+        fprintf(stderr, "%s: no xml files\n", xml_dir);
+        return 1;
+    }
+    // sorted first so the workers' output is already in index order
+    qsort(queue.job, queue.count, sizeof(compile_job_t), job_cmp);
+
+    thread_t worker[PATCH_DB_MAX_THREADS];
+    u32 started = 0;
+    for (u32 i = 1; i < threads && i < queue.count; i++)
+    {
+        started += thread_start(&worker[started], compile_worker, &queue, "patch_db");
+    }
+    compile_worker(&queue);
+    for (u32 i = 0; i < started; i++)
+    {
+        thread_join(worker[i]);
+    }
+    double compiled = now_sec();
+
+    u32 written = 0;
+    bool ok = write_database(out_path, queue.job, queue.count, &written);
+    u64 xml_bytes = 0;
+    for (u32 i = 0; i < queue.count; i++)
+    {
+        xml_bytes += queue.job[i].xml_size;
+        free(queue.job[i].ghp);
+    }
+    free(queue.job);
+    if (!ok)
+    {
+        fprintf(stderr, "%s: could not be written\n", out_path);
+        return 1;
+    }
+    printf("%u of %u titles, %lu bytes of xml, compiled in %.3f s with %u threads, written in %.3f s\n",
+           written, queue.count, xml_bytes, compiled - start, started + 1, now_sec() - compiled);
+    return written == queue.count ? 0 : 2;
+}